@@ -0,0 +1,153 @@
+#include "colorconversion.h"
+#include "colorgrade.h"
+#include "filterchain.h"
+#include "framebuffer.h"
+#include "pipelinemetrics.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QString>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+
+#include <libyuv.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+// Color grade of the camera frame on one thread and in bands over the
+// filter chain's pool, next to the output conversion every frame pays
+// anyway and the frame time at 30 fps. Pass a .cube file, otherwise a
+// synthetic 33 point grade is used.
+namespace
+{
+    const int iterations = 50;
+    const double frameTime = 1000.0 / 30;
+    const double pi = 3.14159265358979323846;
+
+    struct Size
+    {
+        const char *name;
+        std::int32_t width;
+        std::int32_t height;
+    };
+
+    const Size sizes[] = {
+        { "1080p", 1920, 1080 },
+        { "4K", 3840, 2160 },
+    };
+
+    template <typename Run>
+    double measure(Run run)
+    {
+        run();
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < iterations; ++i)
+            run();
+
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+    }
+
+    // Warm highlights and a soft contrast curve, enough to leave no cell flat
+    bool writeSyntheticCube(const QString &fileName)
+    {
+        const int size = 33;
+        QFile file{ fileName };
+
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+            return false;
+
+        QTextStream stream{ &file };
+        stream << "TITLE \"bench\"\nLUT_3D_SIZE " << size << "\n";
+
+        for (int b = 0; b < size; ++b) {
+            for (int g = 0; g < size; ++g) {
+                for (int r = 0; r < size; ++r) {
+                    const auto curve = [](const double value) { return value - 0.1 * std::sin(2 * pi * value); };
+                    const double red = curve(r / double(size - 1));
+                    const double green = curve(g / double(size - 1));
+                    const double blue = curve(b / double(size - 1));
+                    stream << std::min(1.0, red * 1.05) << ' ' << green << ' ' << blue * 0.92 << '\n';
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool same(const FrameView &a, const FrameView &b)
+    {
+        for (std::int32_t y = 0; y < a.height; ++y) {
+            if (std::memcmp(a.data[0] + std::ptrdiff_t(y) * a.stride[0], b.data[0] + std::ptrdiff_t(y) * b.stride[0], std::size_t(a.width) * 4))
+                return false;
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Pipeline metrics run a timer, which needs the application's thread
+    QCoreApplication application{ argc, argv };
+    QTemporaryDir directory;
+    QString fileName = argc > 1 ? QString::fromLocal8Bit(argv[1]) : directory.filePath("bench.cube");
+
+    if (argc < 2 && !writeSyntheticCube(fileName)) {
+        std::fprintf(stderr, "Failed to write %s\n", qPrintable(fileName));
+        return 1;
+    }
+
+    ColorGrade grade;
+
+    if (!grade.load(fileName))
+        return 1;
+
+    grade.setEnabled(true);
+    PipelineMetrics metrics;
+    FilterChain chain{ &metrics };
+    chain.append("grade", &grade);
+
+    std::mt19937 random{ 1 };
+    std::printf("%d threads, frame time %.2f ms\n", QThread::idealThreadCount(), frameTime);
+    std::printf("%-6s %10s %10s %10s\n", "size", "convert", "1 thread", "chain");
+
+    for (const Size &size : sizes) {
+        AlignedFrameBuffer source;
+        AlignedFrameBuffer single;
+        AlignedFrameBuffer banded;
+        AlignedFrameBuffer output;
+        source.allocate(PixelLayout::BGRA, size.width, size.height);
+        single.allocate(PixelLayout::BGRA, size.width, size.height);
+        banded.allocate(PixelLayout::BGRA, size.width, size.height);
+        output.allocate(PixelLayout::NV12, size.width, size.height);
+        const FrameView &frame = source.view();
+
+        for (std::int32_t y = 0; y < frame.height; ++y) {
+            for (std::int32_t x = 0; x < frame.width * 4; ++x)
+                frame.data[0][std::ptrdiff_t(y) * frame.stride[0] + x] = std::uint8_t(random());
+        }
+
+        // Both paths grade the same input once for the comparison
+        libyuv::ARGBCopy(frame.data[0], frame.stride[0], single.view().data[0], single.view().stride[0], frame.width, frame.height);
+        libyuv::ARGBCopy(frame.data[0], frame.stride[0], banded.view().data[0], banded.view().stride[0], frame.width, frame.height);
+        grade.process(single.view(), 0, frame.height);
+        chain.apply(banded.view());
+        const bool exact = same(single.view(), banded.view());
+
+        const frame_converter convert = find_yuv_converter(PixelLayout::NV12, ColorMatrix::BT709, ColorRange::Limited);
+        const double baseline = measure([&]() { convert(frame, output.view()); });
+        const double oneThread = measure([&]() { grade.process(single.view(), 0, frame.height); });
+        const double pooled = measure([&]() { chain.apply(banded.view()); });
+
+        std::printf("%-6s %7.2f ms %7.2f ms %7.2f ms%s\n", size.name, baseline, oneThread, pooled, exact ? "" : "  MISMATCH");
+    }
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+#include "characterpayload.h"
+#include "characterstats.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Compares CharacterPayload::read(), the streaming parser Character loads
+// with, to the QJsonDocument tree it replaced, over the same fields of a
+// D&D Beyond v5 character payload. Both results go through CharacterStats
+// and must agree. Pass saved data.json files, otherwise a synthetic payload
+// of similar shape is used. Peak memory is the resident size of a child
+// process parsing once, over one that does not parse, so only on Unix.
+namespace
+{
+    const int iterations = 200;
+
+    const char *const statKeys[] = { "stats", "bonusStats", "overrideStats" };
+    const char *const modifierKeys[] = { "race", "class", "item" };
+
+    QList<int> statValues(const QJsonArray &array)
+    {
+        QList<int> values;
+
+        for (const QJsonValue &value : array)
+            values.append(value.toObject()["value"].toInt());
+
+        return values;
+    }
+
+    // Same fields the way Character read them before the streaming parser
+    CharacterPayload parseDocument(const QByteArray &bytes)
+    {
+        CharacterPayload payload;
+        const QJsonObject data = QJsonDocument::fromJson(bytes).object()["data"].toObject();
+
+        payload.id = data["id"].toInt();
+        payload.portraitUrl = data["decorations"].toObject()["avatarUrl"].toString();
+        payload.name = data["name"].toString();
+        payload.race = data["race"].toObject()["fullName"].toString();
+        const QJsonObject mainClass = data["classes"].toArray()[0].toObject();
+        payload.level = mainClass["level"].toInt();
+        payload.playerClass = mainClass["definition"].toObject()["name"].toString();
+        payload.stats = statValues(data[statKeys[0]].toArray());
+        payload.bonusStats = statValues(data[statKeys[1]].toArray());
+        payload.overrideStats = statValues(data[statKeys[2]].toArray());
+        payload.baseHitPoints = data["baseHitPoints"].toInt();
+        payload.bonusHitPoints = data["bonusHitPoints"].toInt();
+        payload.overrideHitPoints = data["overrideHitPoints"].toInt();
+        payload.removedHitPoints = data["removedHitPoints"].toInt();
+        payload.temporaryHitPoints = data["temporaryHitPoints"].toInt();
+
+        const QJsonObject modifiers = data["modifiers"].toObject();
+
+        for (int source = 0; source < CharacterPayload::modifierSourceCount; ++source) {
+            for (const QJsonValue &value : modifiers[modifierKeys[source]].toArray()) {
+                const QJsonObject modifier = value.toObject();
+                payload.modifiers[source].append({
+                    modifier["modifierTypeId"].toInt(),
+                    modifier["modifierSubTypeId"].toInt(),
+                    modifier["value"].toInt()
+                });
+            }
+        }
+
+        for (const QJsonValue &value : data["inventory"].toArray()) {
+            const QJsonObject item = value.toObject();
+            const QJsonObject definition = item["definition"].toObject();
+
+            if (item["equipped"].toBool() && definition["armorTypeId"].toInt() > 0) {
+                payload.armorType = static_cast<ArmorType>(definition["armorTypeId"].toInt());
+                payload.armorBase = definition["armorClass"].toInt();
+            }
+        }
+
+        for (const QJsonValue &value : data["feats"].toArray()) {
+            if (value.toObject()["definition"].toObject()["id"].toInt() == 33)
+                payload.mediumArmorExpert = true;
+        }
+
+        return payload;
+    }
+
+    CharacterPayload parseReader(const QByteArray &bytes)
+    {
+        CharacterPayload payload;
+        payload.read(bytes);
+        return payload;
+    }
+
+    bool same(const CharacterPayload &a, const CharacterPayload &b)
+    {
+        CharacterStats first;
+        CharacterStats second;
+        a.applyTo(first);
+        b.applyTo(second);
+        first.commit();
+        second.commit();
+
+        for (int node = 0; node < CharacterStats::NodeCount; ++node) {
+            if (first.value(CharacterStats::Node(node)) != second.value(CharacterStats::Node(node)))
+                return false;
+        }
+
+        return a.id == b.id && a.portraitUrl == b.portraitUrl && a.name == b.name &&
+            a.race == b.race && a.playerClass == b.playerClass;
+    }
+
+    // Same nesting as a real payload, padded with the descriptions and
+    // spell lists that make up most of its size and that no field reads
+    QByteArray syntheticPayload()
+    {
+        const std::string description(600, 'x');
+        std::string json = "{\"id\":1,\"success\":true,\"message\":\"Character successfully received.\",\"data\":{";
+
+        json += "\"id\":12345678,\"readonlyUrl\":\"https://www.dndbeyond.com/characters/12345678\",";
+        json += "\"decorations\":{\"avatarUrl\":\"https://www.dndbeyond.com/avatars/1/2/3.png\",\"themeColor\":null},";
+        json += "\"name\":\"Bench \\u00c9lan\",\"gender\":null,\"faith\":null,\"age\":null,";
+        json += "\"race\":{\"fullName\":\"Hill Dwarf\",\"description\":\"" + description + "\"},";
+        json += "\"classes\":[{\"level\":7,\"isStartingClass\":true,\"definition\":{\"name\":\"Cleric\",\"description\":\"" + description + "\"}}],";
+
+        for (const char *key : statKeys) {
+            json += std::string("\"") + key + "\":[";
+
+            for (int i = 0; i < 6; ++i)
+                json += (i ? "," : "") + std::string("{\"id\":") + std::to_string(i + 1) + ",\"name\":null,\"value\":" + std::to_string(key == statKeys[0] ? 10 + i : i % 2) + "}";
+
+            json += "],";
+        }
+
+        json += "\"baseHitPoints\":45,\"bonusHitPoints\":null,\"overrideHitPoints\":null,\"removedHitPoints\":12,\"temporaryHitPoints\":0,";
+        json += "\"modifiers\":{";
+
+        for (int source = 0; source < 3; ++source) {
+            json += std::string(source ? "," : "") + "\"" + modifierKeys[source] + "\":[";
+
+            for (int i = 0; i < 40; ++i) {
+                json += (i ? "," : "") + std::string("{\"fixedValue\":null,\"id\":\"") + std::to_string(source * 1000 + i) +
+                    "\",\"entityId\":null,\"type\":\"bonus\",\"subType\":\"strength-score\",\"value\":" + std::to_string(i % 3) +
+                    ",\"modifierTypeId\":1,\"modifierSubTypeId\":" + std::to_string(2 + i % 6) +
+                    ",\"friendlyTypeName\":\"Bonus\",\"componentId\":7,\"componentTypeId\":12168134}";
+            }
+
+            json += "]";
+        }
+
+        json += "},\"inventory\":[";
+
+        for (int i = 0; i < 60; ++i) {
+            json += (i ? "," : "") + std::string("{\"id\":") + std::to_string(i) + ",\"equipped\":" + (i == 3 ? "true" : "false") +
+                ",\"quantity\":1,\"definition\":{\"name\":\"Item\",\"armorTypeId\":" + (i == 3 ? "2" : "null") +
+                ",\"armorClass\":" + (i == 3 ? "14" : "null") + ",\"description\":\"" + description + "\",\"tags\":[\"Utility\",\"Combat\"]}}";
+        }
+
+        json += "],\"spells\":{\"class\":[";
+
+        for (int i = 0; i < 120; ++i)
+            json += (i ? "," : "") + std::string("{\"id\":") + std::to_string(i) + ",\"definition\":{\"name\":\"Spell\",\"level\":" + std::to_string(i % 9) + ",\"description\":\"" + description + "\"}}";
+
+        json += "]},\"feats\":[]}}";
+        return QByteArray::fromStdString(json);
+    }
+
+#ifdef Q_OS_UNIX
+    // Peak resident size of a child process that parses once, in KB
+    long peakKilobytes(const QByteArray &bytes, CharacterPayload (*parse)(const QByteArray &))
+    {
+        const pid_t child = ::fork();
+
+        if (child == 0) {
+            if (parse)
+                parse(bytes);
+
+            ::_exit(0);
+        }
+
+        rusage usage{};
+        int status = 0;
+
+        if (child < 0 || ::wait4(child, &status, 0, &usage) != child)
+            return 0;
+
+        return usage.ru_maxrss;
+    }
+#endif
+
+    void run(const char *name, const QByteArray &bytes, CharacterPayload (*parse)(const QByteArray &))
+    {
+        parse(bytes);
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < iterations; ++i)
+            parse(bytes);
+
+        const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+
+#ifdef Q_OS_UNIX
+        // Both children start from the same resident pages of this process
+        const long peak = peakKilobytes(bytes, parse) - peakKilobytes(bytes, nullptr);
+        std::printf("  %-14s %9.1f us  peak %8ld KB\n", name, elapsed.count() / iterations, peak);
+#else
+        std::printf("  %-14s %9.1f us\n", name, elapsed.count() / iterations);
+#endif
+    }
+
+    void bench(const QString &name, const QByteArray &bytes)
+    {
+        std::printf("%s, %lld KB\n", qPrintable(name), (long long)bytes.size() / 1024);
+
+        if (!same(parseDocument(bytes), parseReader(bytes)))
+            std::printf("  parsers disagree on this payload\n");
+
+        run("QJsonDocument", bytes, parseDocument);
+        run("JsonReader", bytes, parseReader);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        bench("synthetic v5 payload", syntheticPayload());
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        QFile file{ QString::fromLocal8Bit(argv[i]) };
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            std::fprintf(stderr, "Failed to open %s\n", argv[i]);
+            return 1;
+        }
+
+        bench(file.fileName(), file.readAll());
+    }
+
+    return 0;
+}
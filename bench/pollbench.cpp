@@ -0,0 +1,174 @@
+#include "character.h"
+#include "characterpoller.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTimer>
+
+#include <cstdio>
+
+// Character poller against a local stand-in of the character service. The
+// stand-in answers 304 while the ETag matches, changes the payload once and
+// then ignores the validators, every request is checked for the validator
+// it carried and the time the poller waited before sending it.
+namespace
+{
+    const int minInterval = 50;
+    const int maxInterval = 200;
+    const int timeout = 10000;
+
+    enum class Answer
+    {
+        First,
+        NotModified,
+        Changed,
+        IgnoreValidators,
+    };
+
+    struct Step
+    {
+        const char *name;
+        Answer answer;
+        // Validator the poller must send, the wait it must have taken before
+        const char *etag;
+        int wait;
+    };
+
+    const Step steps[] = {
+        { "first", Answer::First, "", 0 },
+        { "not modified", Answer::NotModified, "\"a\"", minInterval },
+        { "not modified", Answer::NotModified, "\"a\"", minInterval * 2 },
+        { "changed", Answer::Changed, "\"a\"", minInterval * 4 },
+        { "validators ignored", Answer::IgnoreValidators, "\"b\"", minInterval },
+        { "not modified", Answer::NotModified, "\"b\"", minInterval * 2 },
+        { "not modified", Answer::NotModified, "\"b\"", minInterval * 4 },
+        { "not modified, capped", Answer::NotModified, "\"b\"", maxInterval },
+    };
+
+    const int stepCount = int(sizeof(steps) / sizeof(steps[0]));
+
+    QByteArray payload(const char *name)
+    {
+        return QByteArray{ R"({"data":{"id":1,"name":")" } + name + R"(","stats":[{"value":10}],"baseHitPoints":8}})";
+    }
+
+    QByteArray response(const int status, const QByteArray &etag, const QByteArray &body)
+    {
+        QByteArray bytes = "HTTP/1.1 " + QByteArray::number(status) + (status == 304 ? " Not Modified" : " OK") + "\r\n";
+        bytes += "ETag: " + etag + "\r\n";
+        bytes += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        bytes += "Connection: close\r\n\r\n";
+        return bytes + body;
+    }
+
+    QByteArray header(const QByteArray &request, const QByteArray &name)
+    {
+        for (const QByteArray &line : request.split('\n')) {
+            const int colon = line.indexOf(':');
+
+            if (colon > 0 && line.left(colon).trimmed().toLower() == name.toLower())
+                return line.mid(colon + 1).trimmed();
+        }
+
+        return {};
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application{ argc, argv };
+    QTemporaryDir directory;
+    QTcpServer server;
+
+    if (!directory.isValid() || !server.listen(QHostAddress::LocalHost)) {
+        std::fprintf(stderr, "Failed to set up the stand-in service\n");
+        return 1;
+    }
+
+    qputenv("DUNGEON_CAMERA_SERVICE_URL", "http://127.0.0.1:" + QByteArray::number(server.serverPort()) + "/%1");
+
+    QNetworkAccessManager manager;
+    Character character{ &manager, nullptr, directory.filePath("data") };
+    CharacterPoller poller{ &manager, &character };
+    poller.setIntervals(minInterval, maxInterval);
+
+    QElapsedTimer clock;
+    qint64 previous = 0;
+    int step = 0;
+    int failures = 0;
+
+    QObject::connect(&server, &QTcpServer::newConnection, [&]() {
+        while (QTcpSocket *socket = server.nextPendingConnection()) {
+            QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            QObject::connect(socket, &QTcpSocket::readyRead, [&, socket]() {
+                if (!socket->peek(socket->bytesAvailable()).contains("\r\n\r\n"))
+                    return;
+
+                const QByteArray request = socket->readAll();
+
+                if (step >= stepCount) {
+                    socket->write(response(304, "\"b\"", {}));
+                    socket->disconnectFromHost();
+                    return;
+                }
+
+                const Step &expected = steps[step];
+                const QByteArray etag = header(request, "If-None-Match");
+                const qint64 now = clock.elapsed();
+                const qint64 wait = step > 0 ? now - previous : 0;
+                previous = now;
+
+                // Coarse timers may fire a little early, a wait that kept
+                // doubling past the cap shows up as twice the expected one
+                const bool ok = etag == expected.etag && wait >= expected.wait * 9 / 10 && wait < expected.wait * 3 / 2 + 50;
+                failures += ok ? 0 : 1;
+                std::printf("%d  %-22s %-5s %4lld ms, expected %-5s %4d ms%s\n", step, expected.name,
+                    etag.isEmpty() ? "-" : etag.constData(), wait,
+                    *expected.etag ? expected.etag : "-", expected.wait, ok ? "" : "  FAIL");
+
+                switch (expected.answer) {
+                case Answer::First:
+                    socket->write(response(200, "\"a\"", payload("A")));
+                    break;
+                case Answer::Changed:
+                case Answer::IgnoreValidators:
+                    socket->write(response(200, "\"b\"", payload("B")));
+                    break;
+                case Answer::NotModified:
+                    socket->write(response(304, etag, {}));
+                    break;
+                }
+
+                socket->disconnectFromHost();
+
+                if (++step == stepCount)
+                    QTimer::singleShot(0, &application, &QCoreApplication::quit);
+            });
+        }
+    });
+
+    QTimer::singleShot(timeout, &application, [&]() {
+        std::printf("timed out after %d of %d requests\n", step, stepCount);
+        ++failures;
+        application.quit();
+    });
+
+    clock.start();
+    poller.start(1);
+    application.exec();
+    poller.stop();
+
+    if (character.name() != "B") {
+        std::printf("character was not updated to the changed payload\n");
+        ++failures;
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,291 @@
+#include "backgroundblur.h"
+
+#include <libyuv.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BACKGROUNDBLUR_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    const std::int32_t scaleDown = 4;
+    // In small pixels, two box passes come close to a gaussian
+    const int blurRadius = 4;
+    const int blurPasses = 2;
+    const int maskRadius = 2;
+
+    // Luma steps that count as movement or as differing from the background
+    const int motionThreshold = 10;
+    const int motionDecay = 8;
+    const int backgroundThreshold = 14;
+    const int backgroundGain = 8;
+    // Background learns fast where nobody is and barely at all under players
+    const int fastLearnShift = 5;
+    const int slowLearnShift = 10;
+    const int learnMask = 64;
+
+    // Box blur with a running sum, edges repeat the border pixel
+    template <int Channels>
+    void blur_rows(const FrameView &src, const FrameView &dst, const int radius)
+    {
+        const std::uint32_t scale = 65536 / (2 * radius + 1);
+        const std::int32_t last = src.width - 1;
+
+        for (std::int32_t y = 0; y < src.height; ++y) {
+            const std::uint8_t *in = src.data[0] + std::ptrdiff_t(y) * src.stride[0];
+            std::uint8_t *out = dst.data[0] + std::ptrdiff_t(y) * dst.stride[0];
+            std::uint32_t sums[Channels];
+
+            for (int c = 0; c < Channels; ++c) {
+                sums[c] = in[c] * std::uint32_t(radius + 1);
+
+                for (int i = 1; i <= radius; ++i)
+                    sums[c] += in[std::min(i, last) * Channels + c];
+            }
+
+            for (std::int32_t x = 0; x < src.width; ++x) {
+                const std::uint8_t *add = in + std::min(x + radius + 1, last) * Channels;
+                const std::uint8_t *remove = in + std::max(x - radius, 0) * Channels;
+
+                for (int c = 0; c < Channels; ++c) {
+                    out[x * Channels + c] = std::uint8_t((sums[c] * scale + 32768) >> 16);
+                    sums[c] += add[c] - remove[c];
+                }
+            }
+        }
+    }
+
+    // Keeps a sum for every column, so rows are read in memory order
+    void blur_columns(const FrameView &src, const FrameView &dst, const std::int32_t rowBytes, const int radius, std::vector<std::uint32_t> &sums)
+    {
+        const std::uint32_t scale = 65536 / (2 * radius + 1);
+        const std::int32_t last = src.height - 1;
+        const auto row = [&](const std::int32_t y) {
+            return src.data[0] + std::ptrdiff_t(std::clamp(y, 0, last)) * src.stride[0];
+        };
+
+        sums.assign(rowBytes, 0);
+        std::uint32_t *sum = sums.data();
+
+        for (int i = -radius; i <= radius; ++i) {
+            const std::uint8_t *in = row(i);
+
+            for (std::int32_t x = 0; x < rowBytes; ++x)
+                sum[x] += in[x];
+        }
+
+        for (std::int32_t y = 0; y < src.height; ++y) {
+            std::uint8_t *out = dst.data[0] + std::ptrdiff_t(y) * dst.stride[0];
+            const std::uint8_t *add = row(y + radius + 1);
+            const std::uint8_t *remove = row(y - radius);
+
+            // Separate loops, so neither has stores the other reads
+            for (std::int32_t x = 0; x < rowBytes; ++x)
+                out[x] = std::uint8_t((sum[x] * scale + 32768) >> 16);
+
+            for (std::int32_t x = 0; x < rowBytes; ++x)
+                sum[x] += add[x] - remove[x];
+        }
+    }
+
+    // Frame over the blurred copy, weighted by the mask. Mask is scaled to
+    // 0 - 128, so the product fits in 16 bits; output is opaque.
+    void blend_row_c(std::uint8_t *row, const std::uint8_t *background, const std::uint8_t *mask, const std::int32_t width)
+    {
+        for (std::int32_t x = 0; x < width; ++x, row += 4, background += 4) {
+            const int weight = (mask[x] + (mask[x] >> 7)) >> 1;
+
+            for (int c = 0; c < 3; ++c)
+                row[c] = std::uint8_t(background[c] + (((row[c] - background[c]) * weight) >> 7));
+
+            row[3] = 255;
+        }
+    }
+
+#ifdef BACKGROUNDBLUR_X86
+    void blend_row_sse2(std::uint8_t *row, const std::uint8_t *background, const std::uint8_t *mask, const std::int32_t width)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i opaque = _mm_set1_epi32(int(0xff000000));
+        std::int32_t x = 0;
+
+        for (; x + 16 <= width; x += 16, row += 64, background += 64) {
+            const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + x));
+            const __m128i m0 = _mm_unpacklo_epi8(m, zero);
+            const __m128i m1 = _mm_unpackhi_epi8(m, zero);
+            const __m128i w0 = _mm_srli_epi16(_mm_add_epi16(m0, _mm_srli_epi16(m0, 7)), 1);
+            const __m128i w1 = _mm_srli_epi16(_mm_add_epi16(m1, _mm_srli_epi16(m1, 7)), 1);
+
+            // Every weight repeated for the 4 channels of its pixel
+            const __m128i pairs[4] = {
+                _mm_unpacklo_epi16(w0, w0), _mm_unpackhi_epi16(w0, w0),
+                _mm_unpacklo_epi16(w1, w1), _mm_unpackhi_epi16(w1, w1)
+            };
+
+            for (int i = 0; i < 4; ++i) {
+                const __m128i fore = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + 16 * i));
+                const __m128i back = _mm_loadu_si128(reinterpret_cast<const __m128i *>(background + 16 * i));
+                const __m128i fore_lo = _mm_unpacklo_epi8(fore, zero);
+                const __m128i fore_hi = _mm_unpackhi_epi8(fore, zero);
+                const __m128i back_lo = _mm_unpacklo_epi8(back, zero);
+                const __m128i back_hi = _mm_unpackhi_epi8(back, zero);
+                const __m128i weight_lo = _mm_unpacklo_epi32(pairs[i], pairs[i]);
+                const __m128i weight_hi = _mm_unpackhi_epi32(pairs[i], pairs[i]);
+                const __m128i lo = _mm_add_epi16(back_lo, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(fore_lo, back_lo), weight_lo), 7));
+                const __m128i hi = _mm_add_epi16(back_hi, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(fore_hi, back_hi), weight_hi), 7));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(row + 16 * i), _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+            }
+        }
+
+        blend_row_c(row, background, mask + x, width - x);
+    }
+#endif
+
+    // Replaces copying the mask into alpha, attenuating and blending, three
+    // passes over the full size frame, with one
+    void blend_masked(const FrameView &frame, const FrameView &background, const FrameView &mask, const std::int32_t height)
+    {
+#ifdef BACKGROUNDBLUR_X86
+        const auto blend_row = libyuv::TestCpuFlag(libyuv::kCpuHasSSE2) ? blend_row_sse2 : blend_row_c;
+#else
+        const auto blend_row = blend_row_c;
+#endif
+
+        for (std::int32_t y = 0; y < height; ++y) {
+            blend_row(
+                frame.data[0] + std::ptrdiff_t(y) * frame.stride[0],
+                background.data[0] + std::ptrdiff_t(y) * background.stride[0],
+                mask.data[0] + std::ptrdiff_t(y) * mask.stride[0],
+                frame.width);
+        }
+    }
+
+    template <int Channels>
+    void box_blur(const FrameView &frame, const FrameView &temporary, const int radius, std::vector<std::uint32_t> &sums)
+    {
+        blur_rows<Channels>(frame, temporary, radius);
+        blur_columns(temporary, frame, frame.width * Channels, radius, sums);
+    }
+}
+
+BackgroundBlur::BackgroundBlur() :
+    m_enabled{ false },
+    m_reset{ true }
+{}
+
+void BackgroundBlur::setEnabled(const bool enabled)
+{
+    // Whatever was learned before is stale by the time it is enabled again
+    m_reset = m_reset || (enabled && !m_enabled);
+    m_enabled = enabled;
+}
+
+void BackgroundBlur::process(const FrameView &frame, const std::int32_t, const std::int32_t)
+{
+    const std::int32_t height = std::abs(frame.height);
+    allocate(frame.width, height);
+
+    const FrameView &small = m_small.view();
+    const FrameView &blurred = m_blurred.view();
+    const FrameView &luma = m_luma.view();
+    const FrameView &fullBlurred = m_fullBlurred.view();
+    const FrameView &fullMask = m_fullMask.view();
+    const FrameView &mask = m_mask.view();
+
+    libyuv::ARGBScale(
+        frame.data[0], frame.stride[0], frame.width, height,
+        small.data[0], small.stride[0], small.width, small.height,
+        libyuv::kFilterBox);
+    libyuv::ARGBToJ400(small.data[0], small.stride[0], luma.data[0], luma.stride[0], small.width, small.height);
+    updateMask();
+
+    libyuv::ARGBCopy(small.data[0], small.stride[0], blurred.data[0], blurred.stride[0], small.width, small.height);
+
+    for (int i = 0; i < blurPasses; ++i)
+        box_blur<4>(blurred, m_temporary.view(), blurRadius, m_sums);
+
+    libyuv::ARGBScale(
+        blurred.data[0], blurred.stride[0], blurred.width, blurred.height,
+        fullBlurred.data[0], fullBlurred.stride[0], frame.width, height,
+        libyuv::kFilterBilinear);
+    libyuv::ScalePlane(
+        mask.data[0], mask.stride[0], mask.width, mask.height,
+        fullMask.data[0], fullMask.stride[0], frame.width, height,
+        libyuv::kFilterBilinear);
+
+    blend_masked(frame, fullBlurred, fullMask, height);
+}
+
+void BackgroundBlur::allocate(const std::int32_t width, const std::int32_t height)
+{
+    const std::int32_t smallWidth = std::max(1, (width + scaleDown - 1) / scaleDown);
+    const std::int32_t smallHeight = std::max(1, (height + scaleDown - 1) / scaleDown);
+    const FrameView &full = m_fullBlurred.view();
+
+    if (!m_reset && full.width == width && full.height == height)
+        return;
+
+    m_small.allocate(PixelLayout::BGRA, smallWidth, smallHeight);
+    m_blurred.allocate(PixelLayout::BGRA, smallWidth, smallHeight);
+    m_temporary.allocate(PixelLayout::BGRA, smallWidth, smallHeight);
+    m_luma.allocate(PixelLayout::Gray, smallWidth, smallHeight);
+    m_previous.allocate(PixelLayout::Gray, smallWidth, smallHeight);
+    m_mask.allocate(PixelLayout::Gray, smallWidth, smallHeight);
+    m_maskTemporary.allocate(PixelLayout::Gray, smallWidth, smallHeight);
+    m_fullBlurred.allocate(PixelLayout::BGRA, width, height);
+    m_fullMask.allocate(PixelLayout::Gray, width, height);
+
+    // First frame becomes the background
+    m_background.clear();
+    m_motion.assign(std::size_t(smallWidth) * smallHeight, 0);
+    m_reset = false;
+}
+
+void BackgroundBlur::updateMask()
+{
+    const FrameView &luma = m_luma.view();
+    const FrameView &previous = m_previous.view();
+    const FrameView &mask = m_mask.view();
+    const bool first = m_background.empty();
+
+    if (first)
+        m_background.resize(std::size_t(luma.width) * luma.height);
+
+    for (std::int32_t y = 0; y < luma.height; ++y) {
+        const std::uint8_t *current = luma.data[0] + std::ptrdiff_t(y) * luma.stride[0];
+        std::uint8_t *last = previous.data[0] + std::ptrdiff_t(y) * previous.stride[0];
+        std::uint8_t *out = mask.data[0] + std::ptrdiff_t(y) * mask.stride[0];
+        std::uint16_t *background = m_background.data() + std::ptrdiff_t(y) * luma.width;
+        std::uint8_t *motion = m_motion.data() + std::ptrdiff_t(y) * luma.width;
+
+        for (std::int32_t x = 0; x < luma.width; ++x) {
+            const int value = current[x];
+
+            if (first) {
+                background[x] = std::uint16_t(value << 8);
+                last[x] = std::uint8_t(value);
+            }
+
+            const int moved = std::abs(value - last[x]) > motionThreshold ? 255 : 0;
+            motion[x] = std::uint8_t(std::max(moved, motion[x] - motionDecay));
+
+            const int difference = std::abs(value - (background[x] >> 8));
+            const int differs = std::clamp((difference - backgroundThreshold) * backgroundGain, 0, 255);
+            const int foreground = std::max<int>(motion[x], differs);
+
+            const int target = value << 8;
+            const int shift = foreground < learnMask ? fastLearnShift : slowLearnShift;
+            background[x] = std::uint16_t(background[x] + ((target - background[x]) >> shift));
+
+            out[x] = std::uint8_t(foreground);
+            last[x] = std::uint8_t(value);
+        }
+    }
+
+    // Fills the holes of flat shirts and softens the edge before scaling up
+    box_blur<1>(mask, m_maskTemporary.view(), maskRadius, m_sums);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "videofilter.h"
+
+#include <cstdint>
+#include <vector>
+
+// Blurs everything but the players without a GPU. Both the blur and the
+// foreground mask are computed on a quarter size copy of the frame, only
+// scaling them back up and blending touches every pixel. The mask marks
+// what moves or differs from a slowly learned luma background.
+class BackgroundBlur : public VideoFilter
+{
+public:
+    BackgroundBlur();
+
+    Access access() const override { return Access::Neighborhood; }
+    bool isEnabled() const override { return m_enabled; }
+    void setEnabled(const bool enabled);
+
+    void process(const FrameView &frame, const std::int32_t first, const std::int32_t count) override;
+
+private:
+    void allocate(const std::int32_t width, const std::int32_t height);
+    void updateMask();
+
+private:
+    bool m_enabled;
+    bool m_reset;
+    AlignedFrameBuffer m_small;
+    AlignedFrameBuffer m_blurred;
+    AlignedFrameBuffer m_temporary;
+    AlignedFrameBuffer m_luma;
+    AlignedFrameBuffer m_previous;
+    AlignedFrameBuffer m_mask;
+    AlignedFrameBuffer m_maskTemporary;
+    AlignedFrameBuffer m_fullBlurred;
+    AlignedFrameBuffer m_fullMask;
+    // Background luma in 8.8 fixed point and fading motion of every small pixel
+    std::vector<std::uint16_t> m_background;
+    std::vector<std::uint8_t> m_motion;
+    std::vector<std::uint32_t> m_sums;
+
+};
@@ -1,90 +1,66 @@
 #include "character.h"
-
-#include <cmath>
+#include "characterpayload.h"
+#include "charactersnapshot.h"
+#include "portraitcache.h"
 
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QFile>
+#include <QFileInfo>
 #include <QDebug>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-
-int Ability::totalScore() const
-{
-    if (overrideScore > 0)
-        return overrideScore;
-    else if (setScore > 0)
-        return setScore;
-    else
-        return baseScore + bonusScore;
-}
 
-int Ability::modifier() const
-{
-    return std::floor((totalScore() - 10) / 2);
-}
+Character::Character(QObject *parent) :
+    Character(nullptr, nullptr, "data", parent)
+{}
 
-void Ability::reset()
+Character::Character(QNetworkAccessManager *manager, PortraitCache *portraitCache, const QString &baseName, QObject *parent) :
+    QObject(parent),
+    m_manager{ manager ? manager : new QNetworkAccessManager(this) },
+    m_portraitCache{ portraitCache ? portraitCache : new PortraitCache(m_manager, this) },
+    // Overridable to run against a local stand-in of the character service
+    m_serviceUrl{ qEnvironmentVariable(
+        "DUNGEON_CAMERA_SERVICE_URL",
+        "https://character-service.dndbeyond.com/character/v5/character/%1"
+    ) },
+    m_dataFileName{ baseName + ".json" },
+    m_snapshotFileName{ baseName + ".snapshot" },
+    m_id{ -1 }
 {
-    baseScore = 10;
-    bonusScore = 0;
-    overrideScore = 0;
-    setScore = 0;
+    connect(m_portraitCache, &PortraitCache::ready, this, [this](const QUrl &url, const QSize &size, const QImage &image) {
+        if (url != QUrl{ m_portraitUrl } || size != m_portraitSize)
+            return;
+
+        m_portrait = image;
+        m_portraitSourceUrl = m_portraitUrl;
+        m_portraitSourceSize = size;
+        saveSnapshot();
+        emit portraitUpdated();
+    });
 }
 
-Character::Character(QObject *parent) :
-    QObject(parent),
-    m_manager{ new QNetworkAccessManager(this) },
-    m_id{ -1 },
-    m_level{ 1 },
-    m_abilities{ 6 },
-    m_armorType{ ArmorType::None },
-    m_armorClass{ 0 },
-    m_bonusArmorClass{ 0 },
-    m_mediumArmorExpert{ false },
-    m_baseHitPoints{ 8 },
-    m_bonusHitPoints{ 0 },
-    m_overrideHitPoints{ 0 },
-    m_removedHitPoints{ 0 },
-    m_temporaryHitPoints{ 0 }
-{}
-
 Character::~Character()
 {}
 
-int Character::armorClass() const
+QUrl Character::serviceUrl(const int id) const
 {
-    if (m_armorType != ArmorType::None) {
-        const int maxDexModifier = maxArmorClassModifier();
-        const int dexModifier = std::clamp(m_abilities[1].modifier(), -5, maxDexModifier);
-        return m_armorClass + dexModifier + m_bonusArmorClass;
-    } else {
-        // TODO: unarmored AC
-        return 10 + m_abilities[1].modifier() + m_bonusArmorClass;
-    }
+    return QUrl{ m_serviceUrl.arg(id) };
 }
 
-int Character::maxHitPoints() const
+void Character::load()
 {
-    if (m_overrideHitPoints > 0)
-        return m_overrideHitPoints;
-    else {
-        return m_baseHitPoints +
-            m_bonusHitPoints +
-            m_temporaryHitPoints +
-            m_abilities[2].modifier() * m_level;
+    // Snapshot is only trusted while the data file is unchanged
+    if (loadSnapshot()) {
+        if (!portraitIsCurrent())
+            loadPortrait();
+
+        return;
     }
-}
 
-int Character::currenthitPoints() const
-{
-    return std::clamp(maxHitPoints() - m_removedHitPoints, 0, 2000);
-}
+    QFile file{ m_dataFileName };
 
-void Character::load()
-{
-    QFile file{ "data.json" };
+    // Nothing downloaded yet, e.g. a party member that just joined
+    if (!file.exists())
+        return;
 
     if (!file.open(QIODevice::ReadOnly)) {
         qCritical() << "Failed to open file for loading";
@@ -92,200 +68,154 @@ void Character::load()
     }
 
     loadFromJson(file.readAll());
-    emit updated();
+    saveSnapshot();
     loadPortrait();
 }
 
-void Character::loadPortrait()
+void Character::setPortraitSize(const QSize &size)
 {
-    QNetworkRequest request{ m_portraitUrl };
-    QNetworkReply *reply = m_manager->get(request);
+    if (size == m_portraitSize)
+        return;
 
-    connect(reply, &QNetworkReply::finished, [this, reply]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            QByteArray bytes = reply->readAll();
-            m_portrait = QImage::fromData(bytes);
-            emit portraitUpdated();
-        }
+    // Portraits still decoding at the old size are ignored once they arrive
+    m_portraitSize = size;
 
-        reply->deleteLater();
-    });
+    if (!m_portraitUrl.isEmpty())
+        loadPortrait();
+}
+
+void Character::loadPortrait()
+{
+    m_portraitCache->request(QUrl{ m_portraitUrl }, m_portraitSize);
 }
 
 void Character::reload(const int id)
 {
-    QUrl url{ QString("https://character-service.dndbeyond.com/character/v5/character/%1").arg(id) };
-    QNetworkRequest request{ url };
+    QNetworkRequest request{ serviceUrl(id) };
     QNetworkReply *reply = m_manager->get(request);
 
     connect(reply, &QNetworkReply::finished, [this, reply]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            QByteArray bytes = reply->readAll();
-            QFile file{ "data.json" };
-
-            if (!file.open(QIODevice::WriteOnly)) {
-                qCritical() << "Failed to open file for saving";
-                return;
-            }
-
-            file.write(bytes);
-            loadFromJson(bytes);
-            emit updated();
-            loadPortrait();
-        }
+        if (reply->error() == QNetworkReply::NoError)
+            apply(reply->readAll());
 
         reply->deleteLater();
     });
 }
 
-void Character::loadFromJson(const QByteArray &bytes)
+// Takes a freshly downloaded payload, only differences are signalled
+void Character::apply(const QByteArray &bytes)
 {
-    auto document = QJsonDocument::fromJson(bytes);
-    QJsonObject object = document.object();
-    QJsonObject data = object["data"].toObject();
-    
-    m_id = data["id"].toInt();
-    QJsonObject decorations = data["decorations"].toObject();
-    m_portraitUrl = decorations["avatarUrl"].toString();
-    m_name = data["name"].toString();
-    QJsonObject race = data["race"].toObject();
-    m_race = race["fullName"].toString();
-    QJsonArray classes = data["classes"].toArray();
-    QJsonObject mainClass = classes[0].toObject();
-    m_level = mainClass["level"].toInt();
-    QJsonObject definition = mainClass["definition"].toObject();
-    m_class = definition["name"].toString();
-
-    for (auto &ability : m_abilities)
-        ability.reset();
-
-    QJsonArray stats = data["stats"].toArray();
-    QJsonArray bonusStats = data["bonusStats"].toArray();
-    QJsonArray overrideStats = data["overrideStats"].toArray();
-
-    for (int i = 0; i < stats.size(); ++i) {
-        QJsonObject stat = stats[i].toObject();
-        QJsonObject bonusStat = bonusStats[i].toObject();
-        QJsonObject overrideStat = overrideStats[i].toObject();
-
-        m_abilities[i].baseScore = stat["value"].toInt();
-        m_abilities[i].bonusScore = bonusStat["value"].toInt();
-        m_abilities[i].overrideScore = overrideStat["value"].toInt();
-    }
+    QFile file{ m_dataFileName };
 
-    m_baseHitPoints = data["baseHitPoints"].toInt();
-    m_bonusHitPoints = data["bonusHitPoints"].toInt();
-    m_overrideHitPoints = data["overrideHitPoints"].toInt();
-    m_removedHitPoints = data["removedHitPoints"].toInt();
-    m_temporaryHitPoints = data["temporaryHitPoints"].toInt();
-
-    // Adjust stats from race, class and items
-    // read modifiers/race and modifiers/class
-    // type: bonus
-    // subtype: strength-score
-
-    QJsonObject modifiers = data["modifiers"].toObject();
-    QJsonArray raceModifiers = modifiers["race"].toArray();
-
-    for (QJsonValueRef value : raceModifiers) {
-        QJsonObject modifier = value.toObject();
-        const int modifierTypeId = modifier["modifierTypeId"].toInt();
-        const int modifierSubTypeId = modifier["modifierSubTypeId"].toInt();
-
-        if (modifierTypeId == 1) {
-            const int index = modifierSubTypeId - 2;
-
-            if (index >= 0 && index <= 6)
-                m_abilities[index].bonusScore += modifier["value"].toInt();
-        } else if (modifierTypeId == 9) {
-            const int index = modifierSubTypeId - 175;
-
-            if (index >= 0 && index <= 6)
-                m_abilities[index].setScore = modifier["value"].toInt();
-        }
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(bytes);
+        file.close();
+    } else {
+        qCritical() << "Failed to open file for saving";
     }
 
-    QJsonArray classModifiers = modifiers["class"].toArray();
-
-    for (QJsonValueRef value : classModifiers) {
-        QJsonObject modifier = value.toObject();
-        const int modifierTypeId = modifier["modifierTypeId"].toInt();
-        const int modifierSubTypeId = modifier["modifierSubTypeId"].toInt();
+    loadFromJson(bytes);
+    saveSnapshot();
 
-        if (modifierTypeId == 1) {
-            const int index = modifierSubTypeId - 2;
-
-            if (index >= 0 && index <= 6)
-                m_abilities[index].bonusScore += modifier["value"].toInt();
-        } else if (modifierTypeId == 9) {
-            const int index = modifierSubTypeId - 175;
+    if (!portraitIsCurrent())
+        loadPortrait();
+}
 
-            if (index >= 0 && index <= 6)
-                m_abilities[index].setScore = modifier["value"].toInt();
-        }
-    }
+bool Character::portraitIsCurrent() const
+{
+    return !m_portrait.isNull() && m_portraitSourceUrl == m_portraitUrl && m_portraitSourceSize == m_portraitSize;
+}
 
-    QJsonArray itemModifiers = modifiers["item"].toArray();
+bool Character::loadSnapshot()
+{
+    CharacterSnapshot snapshot;
 
-    for (QJsonValueRef value : itemModifiers) {
-        QJsonObject modifier = value.toObject();
-        const int modifierTypeId = modifier["modifierTypeId"].toInt();
-        const int modifierSubTypeId = modifier["modifierSubTypeId"].toInt();
+    if (!snapshot.read(m_snapshotFileName, QFileInfo{ m_dataFileName }))
+        return false;
 
-        if (modifierTypeId == 1) {
-            const int index = modifierSubTypeId - 2;
+    m_id = snapshot.id;
+    m_portraitUrl = snapshot.portraitUrl;
+    m_name = snapshot.name;
+    m_race = snapshot.race;
+    m_class = snapshot.playerClass;
+    m_portrait = snapshot.portrait;
+    m_portraitSourceUrl = snapshot.portraitSourceUrl;
+    m_portraitSourceSize = snapshot.portraitSize;
 
-            if (index >= 0 && index <= 6)
-                m_abilities[index].bonusScore += modifier["value"].toInt();
-            else if (modifierSubTypeId == 1)
-                m_bonusArmorClass += modifier["value"].toInt();
-        } else if (modifierTypeId == 9) {
-            const int index = modifierSubTypeId - 175;
+    for (int i = 0; i < 6; ++i)
+        m_stats.setAbility(i, snapshot.abilities[i]);
 
-            if (index >= 0 && index <= 6)
-                m_abilities[index].setScore = modifier["value"].toInt();
-        }
-    }
+    for (int node = CharacterStats::ArmorKind; node < CharacterStats::InputCount; ++node)
+        m_stats.setInput(CharacterStats::Node(node), snapshot.inputs[node]);
 
-    QJsonArray inventory = data["inventory"].toArray();
+    const CharacterStats::ChangeSet changes = m_stats.commit();
+    emit updated();
 
-    for (QJsonValueRef value : inventory) {
-        QJsonObject item = value.toObject();
-        const bool equipped = item["equipped"].toBool();
+    if (changes)
+        emit statsChanged(changes);
 
-        if (equipped) {
-            QJsonObject definition = item["definition"].toObject();
-            const int armorTypeId = definition["armorTypeId"].toInt();
+    if (!m_portrait.isNull())
+        emit portraitUpdated();
 
-            if (armorTypeId > 0) {
-                m_armorType = static_cast<ArmorType>(armorTypeId);
-                m_armorClass = definition["armorClass"].toInt();
-            }
-        }
-    }
+    return true;
+}
 
-    QJsonArray feats = data["feats"].toArray();
+void Character::saveSnapshot() const
+{
+    CharacterSnapshot snapshot;
+    snapshot.id = m_id;
+    snapshot.portraitUrl = m_portraitUrl;
+    snapshot.name = m_name;
+    snapshot.race = m_race;
+    snapshot.playerClass = m_class;
+    snapshot.portrait = m_portrait;
+    snapshot.portraitSourceUrl = m_portraitSourceUrl;
+    snapshot.portraitSize = m_portraitSourceSize;
+
+    for (int i = 0; i < 6; ++i)
+        snapshot.abilities[i] = m_stats.ability(i);
+
+    for (int node = CharacterStats::ArmorKind; node < CharacterStats::InputCount; ++node)
+        snapshot.inputs[node] = m_stats.value(CharacterStats::Node(node));
+
+    snapshot.write(m_snapshotFileName, QFileInfo{ m_dataFileName });
+}
 
-    for (QJsonValueRef value : feats) {
-        QJsonObject feat = value.toObject();
-        QJsonObject definition = feat["definition"].toObject();
-        const int id = definition["id"].toInt();
+void Character::setRemovedHitPoints(const int removedHitPoints)
+{
+    m_stats.setInput(CharacterStats::RemovedHitPoints, removedHitPoints);
+    const CharacterStats::ChangeSet changes = m_stats.commit();
 
-        if (id == 33)
-            m_mediumArmorExpert = true;
-    }
+    if (changes)
+        emit statsChanged(changes);
 }
 
-int Character::maxArmorClassModifier() const
+void Character::loadFromJson(const QByteArray &bytes)
 {
-    switch (m_armorType) {
-    case ArmorType::Light:
-        return 10;
-    case ArmorType::Medium:
-        return m_mediumArmorExpert ? 3 : 2;
-    case ArmorType::Heavy:
-        return 0;
-    default:
-        return 10;
-    }
+    // Identity missing from the payload stays what it was
+    CharacterPayload payload;
+    payload.id = m_id;
+    payload.portraitUrl = m_portraitUrl;
+    payload.name = m_name;
+    payload.race = m_race;
+    payload.playerClass = m_class;
+
+    if (!payload.read(bytes))
+        qWarning() << "Character payload is malformed, loaded partially";
+
+    const bool identityChanged = payload.id != m_id || payload.name != m_name || payload.race != m_race || payload.playerClass != m_class;
+    m_id = payload.id;
+    m_portraitUrl = payload.portraitUrl;
+    m_name = payload.name;
+    m_race = payload.race;
+    m_class = payload.playerClass;
+
+    payload.applyTo(m_stats);
+    const CharacterStats::ChangeSet changes = m_stats.commit();
+
+    if (identityChanged)
+        emit updated();
+
+    if (changes)
+        emit statsChanged(changes);
 }
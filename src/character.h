@@ -3,27 +3,11 @@
 #include <QObject>
 #include <QImage>
 
-class QNetworkAccessManager;
-
-struct Ability
-{
-    int baseScore = 10;
-    int bonusScore = 0;
-    int overrideScore = 0;
-    int setScore = 0;
-
-    int totalScore() const;
-    int modifier() const;
-    void reset();
-};
+#include "characterstats.h"
 
-enum class ArmorType
-{
-    None,
-    Light,
-    Medium,
-    Heavy
-};
+class QNetworkAccessManager;
+class QUrl;
+class PortraitCache;
 
 class Character : public QObject
 {
@@ -31,50 +15,59 @@ class Character : public QObject
 
 public:
     Character(QObject *parent);
+    // Shares the network manager and portrait cache, data is kept in baseName.json
+    Character(QNetworkAccessManager *manager, PortraitCache *portraitCache, const QString &baseName, QObject *parent = nullptr);
     ~Character();
 
     int id() const { return m_id; }
     QImage portrait() const { return m_portrait; }
     QString name() const { return m_name; }
-    int level() const { return m_level; }
+    int level() const { return m_stats.value(CharacterStats::Level); }
     QString race() const { return m_race; }
     QString playerClass() const { return m_class; }
-    int armorClass() const;
-    int maxHitPoints() const;
-    int currenthitPoints() const;
+    int armorClass() const { return m_stats.value(CharacterStats::ArmorClass); }
+    int maxHitPoints() const { return m_stats.value(CharacterStats::MaxHitPoints); }
+    int currenthitPoints() const { return m_stats.value(CharacterStats::CurrentHitPoints); }
+    const CharacterStats &stats() const { return m_stats; }
+    QUrl serviceUrl(const int id) const;
 
     void load();
+    void apply(const QByteArray &bytes);
+    void setPortraitSize(const QSize &size);
 
 public slots:
     void reload(const int id);
     void loadPortrait();
+    void setRemovedHitPoints(const int removedHitPoints);
 
 signals:
+    // Identity (id, name, race, class) changed
     void updated();
+    void statsChanged(CharacterStats::ChangeSet changes);
     void portraitUpdated();
 
 private:
     void loadFromJson(const QByteArray &bytes);
-    int maxArmorClassModifier() const;
+    // Portrait is of the current url and size, not one still being replaced
+    bool portraitIsCurrent() const;
+    bool loadSnapshot();
+    void saveSnapshot() const;
 
 private:
     QNetworkAccessManager *m_manager;
+    PortraitCache *m_portraitCache;
+    QString m_serviceUrl;
+    QString m_dataFileName;
+    QString m_snapshotFileName;
     int m_id;
     QString m_portraitUrl;
     QImage m_portrait;
+    QString m_portraitSourceUrl;
+    QSize m_portraitSourceSize;
+    QSize m_portraitSize;
     QString m_name;
-    int m_level;
     QString m_race;
     QString m_class;
-    QList<Ability> m_abilities;
-    ArmorType m_armorType;
-    int m_armorClass;
-    int m_bonusArmorClass;
-    bool m_mediumArmorExpert;
-    int m_baseHitPoints;
-    int m_bonusHitPoints;
-    int m_overrideHitPoints;
-    int m_removedHitPoints;
-    int m_temporaryHitPoints;
+    CharacterStats m_stats;
 
 };
@@ -0,0 +1,226 @@
+#include "characterpayload.h"
+#include "jsonreader.h"
+
+namespace
+{
+    // Medium Armor Master lifts the dexterity cap of medium armor
+    const int mediumArmorExpertFeat = 33;
+
+    void readModifiers(JsonReader &reader, QList<CharacterPayload::Modifier> &modifiers)
+    {
+        reader.readArray([&]() {
+            CharacterPayload::Modifier modifier;
+
+            reader.readObject([&](std::string_view key) {
+                if (key == "modifierTypeId")
+                    modifier.typeId = reader.readInt();
+                else if (key == "modifierSubTypeId")
+                    modifier.subTypeId = reader.readInt();
+                else if (key == "value")
+                    modifier.value = reader.readInt();
+                else
+                    return false;
+
+                return true;
+            });
+
+            modifiers.append(modifier);
+        });
+    }
+
+    // Array of { "value": N } entries, null entries count as zero
+    void readStatValues(JsonReader &reader, QList<int> &values)
+    {
+        reader.readArray([&]() {
+            int value = 0;
+
+            reader.readObject([&](std::string_view key) {
+                if (key != "value")
+                    return false;
+
+                value = reader.readInt();
+                return true;
+            });
+
+            values.append(value);
+        });
+    }
+
+    void readString(JsonReader &reader, const std::string_view wanted, QString &value)
+    {
+        reader.readObject([&](std::string_view key) {
+            if (key != wanted)
+                return false;
+
+            value = QString::fromStdString(reader.readString());
+            return true;
+        });
+    }
+}
+
+bool CharacterPayload::read(const QByteArray &bytes)
+{
+    // Modifiers are only collected here, their position relative to the
+    // stats is not guaranteed
+    JsonReader reader{ bytes.constData(), std::size_t(bytes.size()) };
+
+    reader.readObject([&](std::string_view key) {
+        if (key != "data")
+            return false;
+
+        reader.readObject([&](std::string_view key) {
+            if (key == "id") {
+                id = reader.readInt();
+            } else if (key == "name") {
+                name = QString::fromStdString(reader.readString());
+            } else if (key == "decorations") {
+                readString(reader, "avatarUrl", portraitUrl);
+            } else if (key == "race") {
+                readString(reader, "fullName", race);
+            } else if (key == "classes") {
+                bool mainClass = true;
+
+                reader.readArray([&]() {
+                    if (!mainClass)
+                        return;
+
+                    mainClass = false;
+                    reader.readObject([&](std::string_view key) {
+                        if (key == "level")
+                            level = reader.readInt();
+                        else if (key == "definition")
+                            readString(reader, "name", playerClass);
+                        else
+                            return false;
+
+                        return true;
+                    });
+                });
+            } else if (key == "stats") {
+                readStatValues(reader, stats);
+            } else if (key == "bonusStats") {
+                readStatValues(reader, bonusStats);
+            } else if (key == "overrideStats") {
+                readStatValues(reader, overrideStats);
+            } else if (key == "baseHitPoints") {
+                baseHitPoints = reader.readInt();
+            } else if (key == "bonusHitPoints") {
+                bonusHitPoints = reader.readInt();
+            } else if (key == "overrideHitPoints") {
+                overrideHitPoints = reader.readInt();
+            } else if (key == "removedHitPoints") {
+                removedHitPoints = reader.readInt();
+            } else if (key == "temporaryHitPoints") {
+                temporaryHitPoints = reader.readInt();
+            } else if (key == "modifiers") {
+                reader.readObject([&](std::string_view key) {
+                    if (key == "race")
+                        readModifiers(reader, modifiers[CharacterStats::RaceModifier]);
+                    else if (key == "class")
+                        readModifiers(reader, modifiers[CharacterStats::ClassModifier]);
+                    else if (key == "item")
+                        readModifiers(reader, modifiers[CharacterStats::ItemModifier]);
+                    else
+                        return false;
+
+                    return true;
+                });
+            } else if (key == "inventory") {
+                reader.readArray([&]() {
+                    bool equipped = false;
+                    int armorTypeId = 0;
+                    int armorClass = 0;
+
+                    reader.readObject([&](std::string_view key) {
+                        if (key == "equipped") {
+                            equipped = reader.readBool();
+                        } else if (key == "definition") {
+                            reader.readObject([&](std::string_view key) {
+                                if (key == "armorTypeId")
+                                    armorTypeId = reader.readInt();
+                                else if (key == "armorClass")
+                                    armorClass = reader.readInt();
+                                else
+                                    return false;
+
+                                return true;
+                            });
+                        } else {
+                            return false;
+                        }
+
+                        return true;
+                    });
+
+                    if (equipped && armorTypeId > 0) {
+                        armorType = static_cast<ArmorType>(armorTypeId);
+                        armorBase = armorClass;
+                    }
+                });
+            } else if (key == "feats") {
+                reader.readArray([&]() {
+                    reader.readObject([&](std::string_view key) {
+                        if (key != "definition")
+                            return false;
+
+                        reader.readObject([&](std::string_view key) {
+                            if (key != "id")
+                                return false;
+
+                            if (reader.readInt() == mediumArmorExpertFeat)
+                                mediumArmorExpert = true;
+
+                            return true;
+                        });
+                        return true;
+                    });
+                });
+            } else {
+                return false;
+            }
+
+            return true;
+        });
+        return true;
+    });
+
+    return !reader.hasError();
+}
+
+void CharacterPayload::applyTo(CharacterStats &characterStats) const
+{
+    for (int i = 0; i < 6; ++i) {
+        Ability ability;
+
+        if (i < stats.size()) {
+            ability.baseScore = stats[i];
+            ability.bonusScore = bonusStats.value(i);
+            ability.overrideScore = overrideStats.value(i);
+        }
+
+        characterStats.setAbility(i, ability);
+    }
+
+    characterStats.setInput(CharacterStats::Level, level);
+    characterStats.setInput(CharacterStats::ArmorKind, int(armorType));
+    characterStats.setInput(CharacterStats::ArmorBase, armorBase);
+    characterStats.setInput(CharacterStats::BonusArmorClass, 0);
+    characterStats.setInput(CharacterStats::MediumArmorExpert, mediumArmorExpert);
+    characterStats.setInput(CharacterStats::BaseHitPoints, baseHitPoints);
+    characterStats.setInput(CharacterStats::BonusHitPoints, bonusHitPoints);
+    characterStats.setInput(CharacterStats::OverrideHitPoints, overrideHitPoints);
+    characterStats.setInput(CharacterStats::RemovedHitPoints, removedHitPoints);
+    characterStats.setInput(CharacterStats::TemporaryHitPoints, temporaryHitPoints);
+
+    // Adjust stats from race, class and items, in that order
+    for (int source = 0; source < modifierSourceCount; ++source) {
+        for (const Modifier &modifier : modifiers[source]) {
+            characterStats.applyModifier(
+                CharacterStats::ModifierSource(source),
+                modifier.typeId,
+                modifier.subTypeId,
+                modifier.value
+            );
+        }
+    }
+}
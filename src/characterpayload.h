@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include "characterstats.h"
+
+// Fields of a D&D Beyond v5 character payload the overlay uses, read in a
+// single streaming pass. Fields missing from the payload keep the values
+// they had before read(), so a character can be updated in place.
+struct CharacterPayload
+{
+    struct Modifier
+    {
+        int typeId = 0;
+        int subTypeId = 0;
+        int value = 0;
+    };
+
+    static constexpr int modifierSourceCount = 3;
+
+    int id = -1;
+    QString portraitUrl;
+    QString name;
+    QString race;
+    QString playerClass;
+    QList<int> stats;
+    QList<int> bonusStats;
+    QList<int> overrideStats;
+    int level = 1;
+    ArmorType armorType = ArmorType::None;
+    int armorBase = 0;
+    bool mediumArmorExpert = false;
+    int baseHitPoints = 0;
+    int bonusHitPoints = 0;
+    int overrideHitPoints = 0;
+    int removedHitPoints = 0;
+    int temporaryHitPoints = 0;
+    // By CharacterStats::ModifierSource
+    QList<Modifier> modifiers[modifierSourceCount];
+
+    // False for a malformed payload, whatever came before the error is kept
+    bool read(const QByteArray &bytes);
+    // Stages abilities, inputs and modifiers, committing is up to the caller
+    void applyTo(CharacterStats &characterStats) const;
+};
@@ -0,0 +1,121 @@
+#include "characterpoller.h"
+#include "character.h"
+
+#include <algorithm>
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTimer>
+
+namespace
+{
+    const int minInterval = 5000;
+    const int maxInterval = 60000;
+}
+
+CharacterPoller::CharacterPoller(QNetworkAccessManager *manager, Character *character, QObject *parent) :
+    QObject(parent),
+    m_character{ character },
+    m_manager{ manager ? manager : new QNetworkAccessManager(this) },
+    m_timer{ new QTimer(this) },
+    m_id{ -1 },
+    m_minInterval{ minInterval },
+    m_maxInterval{ maxInterval },
+    m_interval{ minInterval }
+{
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &CharacterPoller::poll);
+}
+
+CharacterPoller::~CharacterPoller()
+{}
+
+void CharacterPoller::setIntervals(const int minimum, const int maximum)
+{
+    m_minInterval = minimum;
+    m_maxInterval = std::max(minimum, maximum);
+}
+
+void CharacterPoller::start(const int id)
+{
+    if (id != m_id) {
+        m_etag.clear();
+        m_lastModified.clear();
+        m_hash.clear();
+    }
+
+    m_id = id;
+    m_interval = m_minInterval;
+    poll();
+}
+
+void CharacterPoller::stop()
+{
+    m_id = -1;
+    m_timer->stop();
+}
+
+void CharacterPoller::poll()
+{
+    if (m_id < 0)
+        return;
+
+    QNetworkRequest request{ m_character->serviceUrl(m_id) };
+
+    if (!m_etag.isEmpty())
+        request.setRawHeader("If-None-Match", m_etag);
+
+    if (!m_lastModified.isEmpty())
+        request.setRawHeader("If-Modified-Since", m_lastModified);
+
+    const int id = m_id;
+    QNetworkReply *reply = m_manager->get(request);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, id]() {
+        reply->deleteLater();
+
+        // Stopped or switched to another character meanwhile
+        if (id != m_id)
+            return;
+
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+        if (reply->error() != QNetworkReply::NoError) {
+            qWarning() << "Character poll failed" << reply->errorString();
+            schedule(false);
+            return;
+        }
+
+        if (status == 304) {
+            schedule(false);
+            return;
+        }
+
+        if (reply->hasRawHeader("ETag"))
+            m_etag = reply->rawHeader("ETag");
+
+        if (reply->hasRawHeader("Last-Modified"))
+            m_lastModified = reply->rawHeader("Last-Modified");
+
+        // Service does not always honor validators, skip parsing identical bodies
+        const QByteArray bytes = reply->readAll();
+        const QByteArray hash = QCryptographicHash::hash(bytes, QCryptographicHash::Sha1);
+
+        if (hash == m_hash) {
+            schedule(false);
+            return;
+        }
+
+        m_hash = hash;
+        m_character->apply(bytes);
+        schedule(true);
+    });
+}
+
+void CharacterPoller::schedule(const bool changed)
+{
+    m_interval = changed ? m_minInterval : std::min(m_interval * 2, m_maxInterval);
+    m_timer->start(m_interval);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+
+class QNetworkAccessManager;
+class QTimer;
+class Character;
+
+// Periodically refreshes a character with conditional requests.
+// The interval backs off while nothing changes and snaps back to the
+// minimum as soon as the payload differs.
+class CharacterPoller : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Shares the network manager with the character and portraits
+    CharacterPoller(QNetworkAccessManager *manager, Character *character, QObject *parent = nullptr);
+    ~CharacterPoller();
+
+    bool isActive() const { return m_id >= 0; }
+    int interval() const { return m_interval; }
+    // In milliseconds, 5 s backing off to 60 s unless set
+    void setIntervals(const int minimum, const int maximum);
+
+public slots:
+    void start(const int id);
+    void stop();
+
+private:
+    void poll();
+    void schedule(const bool changed);
+
+private:
+    Character *m_character;
+    QNetworkAccessManager *m_manager;
+    QTimer *m_timer;
+    int m_id;
+    int m_minInterval;
+    int m_maxInterval;
+    int m_interval;
+    QByteArray m_etag;
+    QByteArray m_lastModified;
+    QByteArray m_hash;
+
+};
@@ -0,0 +1,134 @@
+#include "charactersnapshot.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace
+{
+    const char magic[4] = { 'D', 'C', 'S', 'N' };
+    // Bump on any layout or CharacterStats::Node change
+    const quint32 version = 2;
+    const quint32 alignment = 64;
+
+    struct Header
+    {
+        char magic[4];
+        quint32 version;
+        qint64 sourceSize;
+        qint64 sourceModified;
+        quint32 metaOffset;
+        quint32 metaSize;
+        quint32 portraitOffset;
+        qint32 portraitWidth;
+        qint32 portraitHeight;
+        qint32 portraitBytesPerLine;
+    };
+
+    quint32 align(const quint32 offset)
+    {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+bool CharacterSnapshot::read(const QString &fileName, const QFileInfo &source)
+{
+    QFile file{ fileName };
+
+    if (!source.exists() || !file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(Header)))
+        return false;
+
+    uchar *data = file.map(0, file.size());
+
+    if (!data)
+        return false;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+
+    const quint64 portraitBytes = quint64(header.portraitBytesPerLine) * quint64(std::max(header.portraitHeight, 0));
+    const bool valid =
+        std::memcmp(header.magic, magic, sizeof(magic)) == 0 &&
+        header.version == version &&
+        header.sourceSize == source.size() &&
+        header.sourceModified == source.lastModified().toMSecsSinceEpoch() &&
+        quint64(header.metaOffset) + header.metaSize <= quint64(file.size()) &&
+        quint64(header.portraitOffset) + portraitBytes <= quint64(file.size());
+
+    if (!valid) {
+        file.unmap(data);
+        return false;
+    }
+
+    QDataStream stream{ QByteArray::fromRawData(reinterpret_cast<const char *>(data) + header.metaOffset, header.metaSize) };
+    stream >> id >> portraitUrl >> name >> race >> playerClass >> portraitSourceUrl >> portraitSize;
+
+    for (Ability &ability : abilities)
+        stream >> ability.baseScore >> ability.bonusScore >> ability.overrideScore >> ability.setScore;
+
+    for (int &input : inputs)
+        stream >> input;
+
+    // Raw premultiplied pixels, copied straight out of the mapping without decoding
+    if (header.portraitWidth > 0 && header.portraitHeight > 0) {
+        portrait = QImage{
+            data + header.portraitOffset,
+            header.portraitWidth,
+            header.portraitHeight,
+            header.portraitBytesPerLine,
+            QImage::Format_ARGB32_Premultiplied
+        }.copy();
+    }
+
+    file.unmap(data);
+    return stream.status() == QDataStream::Ok;
+}
+
+bool CharacterSnapshot::write(const QString &fileName, const QFileInfo &source) const
+{
+    QByteArray meta;
+    QDataStream stream{ &meta, QIODevice::WriteOnly };
+    stream << id << portraitUrl << name << race << playerClass << portraitSourceUrl << portraitSize;
+
+    for (const Ability &ability : abilities)
+        stream << ability.baseScore << ability.bonusScore << ability.overrideScore << ability.setScore;
+
+    for (const int input : inputs)
+        stream << input;
+
+    const QImage image = portrait.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.sourceSize = source.size();
+    header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+    header.metaOffset = align(sizeof(Header));
+    header.metaSize = meta.size();
+    header.portraitOffset = align(header.metaOffset + header.metaSize);
+    header.portraitWidth = image.width();
+    header.portraitHeight = image.height();
+    header.portraitBytesPerLine = image.bytesPerLine();
+
+    QByteArray bytes{ qsizetype(header.portraitOffset) + image.sizeInBytes(), '\0' };
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + header.metaOffset, meta.constData(), meta.size());
+
+    if (!image.isNull())
+        std::memcpy(bytes.data() + header.portraitOffset, image.constBits(), image.sizeInBytes());
+
+    QSaveFile file{ fileName };
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open snapshot for saving";
+        return false;
+    }
+
+    file.write(bytes);
+    return file.commit();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+#include "characterstats.h"
+
+class QFileInfo;
+
+// Versioned binary image of a loaded character, including the portrait
+// already decoded and scaled for the overlay. Lets startup skip parsing
+// data.json and waiting for the portrait download.
+struct CharacterSnapshot
+{
+    int id = -1;
+    QString portraitUrl;
+    QString name;
+    QString race;
+    QString playerClass;
+    Ability abilities[6];
+    int inputs[CharacterStats::InputCount] = {};
+    QImage portrait;
+    // Url and size the portrait was decoded from, may lag behind portraitUrl
+    QString portraitSourceUrl;
+    QSize portraitSize;
+
+    bool read(const QString &fileName, const QFileInfo &source);
+    bool write(const QString &fileName, const QFileInfo &source) const;
+};
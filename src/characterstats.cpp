@@ -0,0 +1,247 @@
+#include "characterstats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    using Node = CharacterStats::Node;
+    using ChangeSet = CharacterStats::ChangeSet;
+
+    constexpr ChangeSet bit(const Node node) { return CharacterStats::bit(node); }
+
+    struct Rule
+    {
+        Node node;
+        ChangeSet dependencies;
+        int (*compute)(const CharacterStats &stats);
+    };
+
+    template <int Index>
+    int abilityModifier(const CharacterStats &stats)
+    {
+        return stats.ability(Index).modifier();
+    }
+
+    int maxDexterityBonus(const CharacterStats &stats)
+    {
+        switch (static_cast<ArmorType>(stats.value(CharacterStats::ArmorKind))) {
+        case ArmorType::Light:
+            return 10;
+        case ArmorType::Medium:
+            return stats.value(CharacterStats::MediumArmorExpert) ? 3 : 2;
+        case ArmorType::Heavy:
+            return 0;
+        default:
+            return 10;
+        }
+    }
+
+    int armorClass(const CharacterStats &stats)
+    {
+        const int dexModifier = stats.value(CharacterStats::DexterityModifier);
+        const int bonus = stats.value(CharacterStats::BonusArmorClass);
+
+        if (static_cast<ArmorType>(stats.value(CharacterStats::ArmorKind)) != ArmorType::None) {
+            const int maxDexModifier = stats.value(CharacterStats::MaxDexterityBonus);
+            return stats.value(CharacterStats::ArmorBase) + std::clamp(dexModifier, -5, maxDexModifier) + bonus;
+        } else {
+            // TODO: unarmored AC
+            return 10 + dexModifier + bonus;
+        }
+    }
+
+    int maxHitPoints(const CharacterStats &stats)
+    {
+        if (stats.value(CharacterStats::OverrideHitPoints) > 0)
+            return stats.value(CharacterStats::OverrideHitPoints);
+        else {
+            return stats.value(CharacterStats::BaseHitPoints) +
+                stats.value(CharacterStats::BonusHitPoints) +
+                stats.value(CharacterStats::TemporaryHitPoints) +
+                stats.value(CharacterStats::ConstitutionModifier) * stats.value(CharacterStats::Level);
+        }
+    }
+
+    int currentHitPoints(const CharacterStats &stats)
+    {
+        return std::clamp(stats.value(CharacterStats::MaxHitPoints) - stats.value(CharacterStats::RemovedHitPoints), 0, 2000);
+    }
+
+    // Topologically sorted, a rule only depends on inputs and earlier rules
+    const Rule rules[] = {
+        { CharacterStats::StrengthModifier, bit(CharacterStats::Strength), &abilityModifier<0> },
+        { CharacterStats::DexterityModifier, bit(CharacterStats::Dexterity), &abilityModifier<1> },
+        { CharacterStats::ConstitutionModifier, bit(CharacterStats::Constitution), &abilityModifier<2> },
+        { CharacterStats::IntelligenceModifier, bit(CharacterStats::Intelligence), &abilityModifier<3> },
+        { CharacterStats::WisdomModifier, bit(CharacterStats::Wisdom), &abilityModifier<4> },
+        { CharacterStats::CharismaModifier, bit(CharacterStats::Charisma), &abilityModifier<5> },
+        {
+            CharacterStats::MaxDexterityBonus,
+            bit(CharacterStats::ArmorKind) | bit(CharacterStats::MediumArmorExpert),
+            &maxDexterityBonus
+        },
+        {
+            CharacterStats::ArmorClass,
+            bit(CharacterStats::ArmorKind) | bit(CharacterStats::ArmorBase) | bit(CharacterStats::BonusArmorClass) |
+                bit(CharacterStats::DexterityModifier) | bit(CharacterStats::MaxDexterityBonus),
+            &armorClass
+        },
+        {
+            CharacterStats::MaxHitPoints,
+            bit(CharacterStats::BaseHitPoints) | bit(CharacterStats::BonusHitPoints) | bit(CharacterStats::OverrideHitPoints) |
+                bit(CharacterStats::TemporaryHitPoints) | bit(CharacterStats::ConstitutionModifier) | bit(CharacterStats::Level),
+            &maxHitPoints
+        },
+        {
+            CharacterStats::CurrentHitPoints,
+            bit(CharacterStats::MaxHitPoints) | bit(CharacterStats::RemovedHitPoints),
+            &currentHitPoints
+        },
+    };
+
+    enum class ModifierTarget
+    {
+        AbilityBonus,
+        AbilitySet,
+        ArmorClassBonus
+    };
+
+    const unsigned allSources = ~0u;
+    const unsigned itemSources = 1u << CharacterStats::ItemModifier;
+
+    struct ModifierRule
+    {
+        int typeId;
+        int firstSubTypeId;
+        int count;
+        ModifierTarget target;
+        unsigned sources;
+    };
+
+    // D&D Beyond modifier ids, subtypes of a rule are consecutive
+    const ModifierRule modifierRules[] = {
+        // type: bonus, subtype: strength-score .. charisma-score
+        { 1, 2, 6, ModifierTarget::AbilityBonus, allSources },
+        // type: set, subtype: strength-score .. charisma-score
+        { 9, 175, 6, ModifierTarget::AbilitySet, allSources },
+        // type: bonus, subtype: armor-class
+        { 1, 1, 1, ModifierTarget::ArmorClassBonus, itemSources },
+    };
+}
+
+int Ability::totalScore() const
+{
+    if (overrideScore > 0)
+        return overrideScore;
+    else if (setScore > 0)
+        return setScore;
+    else
+        return baseScore + bonusScore;
+}
+
+int Ability::modifier() const
+{
+    return std::floor((totalScore() - 10) / 2.0);
+}
+
+void Ability::reset()
+{
+    baseScore = 10;
+    bonusScore = 0;
+    overrideScore = 0;
+    setScore = 0;
+}
+
+CharacterStats::CharacterStats() :
+    m_values{},
+    m_dirty{ 0 }
+{
+    for (int i = 0; i < 6; ++i)
+        m_values[i] = m_abilities[i].totalScore();
+
+    m_values[Level] = 1;
+    m_values[BaseHitPoints] = 8;
+    std::copy(m_values, m_values + InputCount, m_committed);
+
+    for (const Rule &rule : rules)
+        m_values[rule.node] = rule.compute(*this);
+}
+
+void CharacterStats::setAbility(const int index, const Ability &ability)
+{
+    m_abilities[index] = ability;
+    m_values[index] = ability.totalScore();
+    m_dirty |= bit(Node(index));
+}
+
+void CharacterStats::setInput(const Node node, const int value)
+{
+    Q_ASSERT(node >= ArmorKind && node < InputCount);
+    m_values[node] = value;
+    m_dirty |= bit(node);
+}
+
+// Stages a D&D Beyond modifier, returns false if it does not affect tracked stats
+bool CharacterStats::applyModifier(const ModifierSource source, const int typeId, const int subTypeId, const int value)
+{
+    for (const ModifierRule &rule : modifierRules) {
+        const int index = subTypeId - rule.firstSubTypeId;
+
+        if (rule.typeId != typeId || index < 0 || index >= rule.count || !(rule.sources & (1u << source)))
+            continue;
+
+        Ability ability;
+
+        switch (rule.target) {
+        case ModifierTarget::AbilityBonus:
+            ability = m_abilities[index];
+            ability.bonusScore += value;
+            setAbility(index, ability);
+            break;
+        case ModifierTarget::AbilitySet:
+            ability = m_abilities[index];
+            ability.setScore = value;
+            setAbility(index, ability);
+            break;
+        case ModifierTarget::ArmorClassBonus:
+            setInput(BonusArmorClass, m_values[BonusArmorClass] + value);
+            break;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+CharacterStats::ChangeSet CharacterStats::commit()
+{
+    ChangeSet changes = 0;
+
+    // Inputs staged back to their previous value do not propagate
+    for (int node = 0; node < InputCount; ++node) {
+        if ((m_dirty & bit(Node(node))) && m_values[node] != m_committed[node]) {
+            m_committed[node] = m_values[node];
+            changes |= bit(Node(node));
+        }
+    }
+
+    ChangeSet dirty = changes;
+
+    for (const Rule &rule : rules) {
+        if (!(rule.dependencies & dirty))
+            continue;
+
+        const int value = rule.compute(*this);
+
+        if (value != m_values[rule.node]) {
+            m_values[rule.node] = value;
+            dirty |= bit(rule.node);
+            changes |= bit(rule.node);
+        }
+    }
+
+    m_dirty = 0;
+    return changes;
+}
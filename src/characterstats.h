@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QtGlobal>
+
+struct Ability
+{
+    int baseScore = 10;
+    int bonusScore = 0;
+    int overrideScore = 0;
+    int setScore = 0;
+
+    int totalScore() const;
+    int modifier() const;
+    void reset();
+};
+
+enum class ArmorType
+{
+    None,
+    Light,
+    Medium,
+    Heavy
+};
+
+// Raw character inputs and the stats derived from them, kept as a small
+// dependency graph. Inputs are staged with setAbility()/setInput() and
+// commit() recomputes only derived stats whose dependencies actually changed,
+// returning the set of nodes with a new value.
+class CharacterStats
+{
+public:
+    enum Node
+    {
+        // Inputs, abilities first so their index matches the ability index
+        Strength,
+        Dexterity,
+        Constitution,
+        Intelligence,
+        Wisdom,
+        Charisma,
+        ArmorKind,
+        ArmorBase,
+        BonusArmorClass,
+        MediumArmorExpert,
+        Level,
+        BaseHitPoints,
+        BonusHitPoints,
+        OverrideHitPoints,
+        RemovedHitPoints,
+        TemporaryHitPoints,
+        InputCount,
+
+        // Derived, in dependency order
+        StrengthModifier = InputCount,
+        DexterityModifier,
+        ConstitutionModifier,
+        IntelligenceModifier,
+        WisdomModifier,
+        CharismaModifier,
+        MaxDexterityBonus,
+        ArmorClass,
+        MaxHitPoints,
+        CurrentHitPoints,
+        NodeCount
+    };
+
+    enum ModifierSource
+    {
+        RaceModifier,
+        ClassModifier,
+        ItemModifier
+    };
+
+    using ChangeSet = quint32;
+    static constexpr ChangeSet bit(const Node node) { return ChangeSet(1) << node; }
+    static constexpr ChangeSet allNodes = (ChangeSet(1) << NodeCount) - 1;
+
+    CharacterStats();
+
+    int value(const Node node) const { return m_values[node]; }
+    const Ability &ability(const int index) const { return m_abilities[index]; }
+
+    void setAbility(const int index, const Ability &ability);
+    void setInput(const Node node, const int value);
+    bool applyModifier(const ModifierSource source, const int typeId, const int subTypeId, const int value);
+    ChangeSet commit();
+
+private:
+    Ability m_abilities[6];
+    int m_values[NodeCount];
+    int m_committed[InputCount];
+    ChangeSet m_dirty;
+
+};
+
+static_assert(CharacterStats::NodeCount <= 32, "ChangeSet is too narrow");
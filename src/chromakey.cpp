@@ -0,0 +1,266 @@
+#include "chromakey.h"
+
+#include <QPainter>
+#include <libyuv.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CHROMAKEY_X86
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+#endif
+
+namespace
+{
+    const int defaultSimilarity = 40;
+    const int defaultSmoothness = 30;
+
+    struct Key
+    {
+        // Chroma coefficients in 8 bit fixed point, small enough that every
+        // partial sum fits in 16 bits
+        short ub, ug, ur;
+        short vb, vg, vr;
+        short u, v;
+        float inner;
+        float scale;
+    };
+
+    typedef void (*key_row_function)(const Key &key, std::uint8_t *row, const std::uint8_t *background, const std::int32_t width);
+
+    template <ColorMatrix Matrix>
+    Key make_key(const QColor &color, const int similarity, const int smoothness)
+    {
+        using C = Coefficients<Matrix, ColorRange::Full>;
+        const auto reduce = [](const int value) {
+            return short((value + (1 << (C::shift - 9))) >> (C::shift - 8));
+        };
+
+        Key key;
+        key.ub = reduce(C::ub);
+        key.ug = reduce(C::ug);
+        key.ur = reduce(C::ur);
+        key.vb = reduce(C::vb);
+        key.vg = reduce(C::vg);
+        key.vr = reduce(C::vr);
+        key.u = short((key.ub * color.blue() + key.ug * color.green() + key.ur * color.red()) >> 8);
+        key.v = short((key.vb * color.blue() + key.vg * color.green() + key.vr * color.red()) >> 8);
+
+        // Ramp over squared distances saves a square root per pixel
+        const float outer = float(similarity + smoothness) * float(similarity + smoothness);
+        key.inner = float(similarity) * float(similarity);
+        key.scale = 128.0f / std::max(1.0f, outer - key.inner);
+        return key;
+    }
+
+    // Reference kernel, the vector ones produce the very same bytes
+    void key_row_c(const Key &key, std::uint8_t *row, const std::uint8_t *background, const std::int32_t width)
+    {
+        for (std::int32_t x = 0; x < width; ++x, row += 4, background += 4) {
+            const int b = row[0];
+            const int g = row[1];
+            const int r = row[2];
+            const int du = ((key.ub * b + key.ug * g + key.ur * r) >> 8) - key.u;
+            const int dv = ((key.vb * b + key.vg * g + key.vr * r) >> 8) - key.v;
+            const float ramp = (float(du * du + dv * dv) - key.inner) * key.scale;
+            const int alpha = int(std::min(std::max(ramp, 0.0f), 128.0f));
+
+            for (int c = 0; c < 4; ++c)
+                row[c] = std::uint8_t(background[c] + (((row[c] - background[c]) * alpha) >> 7));
+        }
+    }
+
+#ifdef CHROMAKEY_X86
+    void key_row_sse2(const Key &key, std::uint8_t *row, const std::uint8_t *background, const std::int32_t width)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i mask = _mm_set1_epi32(0xff);
+        const __m128i ub = _mm_set1_epi16(key.ub), ug = _mm_set1_epi16(key.ug), ur = _mm_set1_epi16(key.ur);
+        const __m128i vb = _mm_set1_epi16(key.vb), vg = _mm_set1_epi16(key.vg), vr = _mm_set1_epi16(key.vr);
+        const __m128i ku = _mm_set1_epi16(key.u), kv = _mm_set1_epi16(key.v);
+        const __m128 inner = _mm_set1_ps(key.inner), scale = _mm_set1_ps(key.scale);
+        const __m128 opaque = _mm_set1_ps(128.0f), transparent = _mm_setzero_ps();
+        std::int32_t x = 0;
+
+        // 8 pixels a step, channels are spread into 16 bit lanes
+        for (; x + 8 <= width; x += 8, row += 32, background += 32) {
+            const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row));
+            const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + 16));
+            const __m128i b = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+            const __m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask), _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+            const __m128i r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask), _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+
+            const __m128i u = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(b, ub), _mm_mullo_epi16(g, ug)), _mm_mullo_epi16(r, ur)), 8);
+            const __m128i v = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(b, vb), _mm_mullo_epi16(g, vg)), _mm_mullo_epi16(r, vr)), 8);
+            const __m128i du = _mm_sub_epi16(u, ku);
+            const __m128i dv = _mm_sub_epi16(v, kv);
+            const __m128i duv0 = _mm_unpacklo_epi16(du, dv);
+            const __m128i duv1 = _mm_unpackhi_epi16(du, dv);
+
+            const __m128 ramp0 = _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_madd_epi16(duv0, duv0)), inner), scale);
+            const __m128 ramp1 = _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_madd_epi16(duv1, duv1)), inner), scale);
+            const __m128i alpha = _mm_packs_epi32(
+                _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(ramp0, transparent), opaque)),
+                _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(ramp1, transparent), opaque)));
+
+            // Every alpha repeated for the 4 channels of its pixel
+            const __m128i alpha0 = _mm_unpacklo_epi16(alpha, alpha);
+            const __m128i alpha1 = _mm_unpackhi_epi16(alpha, alpha);
+            const __m128i weights[4] = {
+                _mm_unpacklo_epi32(alpha0, alpha0), _mm_unpackhi_epi32(alpha0, alpha0),
+                _mm_unpacklo_epi32(alpha1, alpha1), _mm_unpackhi_epi32(alpha1, alpha1)
+            };
+            const __m128i pixels[2] = { p0, p1 };
+
+            for (int i = 0; i < 2; ++i) {
+                const __m128i back = _mm_loadu_si128(reinterpret_cast<const __m128i *>(background + 16 * i));
+                const __m128i fore_lo = _mm_unpacklo_epi8(pixels[i], zero);
+                const __m128i fore_hi = _mm_unpackhi_epi8(pixels[i], zero);
+                const __m128i back_lo = _mm_unpacklo_epi8(back, zero);
+                const __m128i back_hi = _mm_unpackhi_epi8(back, zero);
+                const __m128i lo = _mm_add_epi16(back_lo, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(fore_lo, back_lo), weights[2 * i]), 7));
+                const __m128i hi = _mm_add_epi16(back_hi, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(fore_hi, back_hi), weights[2 * i + 1]), 7));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(row + 16 * i), _mm_packus_epi16(lo, hi));
+            }
+        }
+
+        key_row_c(key, row, background, width - x);
+    }
+
+    // Same steps as SSE2 on 16 pixels; packs and unpacks work per 128 bit
+    // lane, so the pixel order they produce matches up without permutes
+    TARGET_AVX2 void key_row_avx2(const Key &key, std::uint8_t *row, const std::uint8_t *background, const std::int32_t width)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i mask = _mm256_set1_epi32(0xff);
+        const __m256i ub = _mm256_set1_epi16(key.ub), ug = _mm256_set1_epi16(key.ug), ur = _mm256_set1_epi16(key.ur);
+        const __m256i vb = _mm256_set1_epi16(key.vb), vg = _mm256_set1_epi16(key.vg), vr = _mm256_set1_epi16(key.vr);
+        const __m256i ku = _mm256_set1_epi16(key.u), kv = _mm256_set1_epi16(key.v);
+        const __m256 inner = _mm256_set1_ps(key.inner), scale = _mm256_set1_ps(key.scale);
+        const __m256 opaque = _mm256_set1_ps(128.0f), transparent = _mm256_setzero_ps();
+        std::int32_t x = 0;
+
+        for (; x + 16 <= width; x += 16, row += 64, background += 64) {
+            const __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row));
+            const __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + 32));
+            const __m256i b = _mm256_packs_epi32(_mm256_and_si256(p0, mask), _mm256_and_si256(p1, mask));
+            const __m256i g = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, 8), mask), _mm256_and_si256(_mm256_srli_epi32(p1, 8), mask));
+            const __m256i r = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(p0, 16), mask), _mm256_and_si256(_mm256_srli_epi32(p1, 16), mask));
+
+            const __m256i u = _mm256_srai_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(b, ub), _mm256_mullo_epi16(g, ug)), _mm256_mullo_epi16(r, ur)), 8);
+            const __m256i v = _mm256_srai_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(b, vb), _mm256_mullo_epi16(g, vg)), _mm256_mullo_epi16(r, vr)), 8);
+            const __m256i du = _mm256_sub_epi16(u, ku);
+            const __m256i dv = _mm256_sub_epi16(v, kv);
+            const __m256i duv0 = _mm256_unpacklo_epi16(du, dv);
+            const __m256i duv1 = _mm256_unpackhi_epi16(du, dv);
+
+            const __m256 ramp0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(duv0, duv0)), inner), scale);
+            const __m256 ramp1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(duv1, duv1)), inner), scale);
+            const __m256i alpha = _mm256_packs_epi32(
+                _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(ramp0, transparent), opaque)),
+                _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(ramp1, transparent), opaque)));
+
+            const __m256i alpha0 = _mm256_unpacklo_epi16(alpha, alpha);
+            const __m256i alpha1 = _mm256_unpackhi_epi16(alpha, alpha);
+            const __m256i weights[4] = {
+                _mm256_unpacklo_epi32(alpha0, alpha0), _mm256_unpackhi_epi32(alpha0, alpha0),
+                _mm256_unpacklo_epi32(alpha1, alpha1), _mm256_unpackhi_epi32(alpha1, alpha1)
+            };
+            const __m256i pixels[2] = { p0, p1 };
+
+            for (int i = 0; i < 2; ++i) {
+                const __m256i back = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(background + 32 * i));
+                const __m256i fore_lo = _mm256_unpacklo_epi8(pixels[i], zero);
+                const __m256i fore_hi = _mm256_unpackhi_epi8(pixels[i], zero);
+                const __m256i back_lo = _mm256_unpacklo_epi8(back, zero);
+                const __m256i back_hi = _mm256_unpackhi_epi8(back, zero);
+                const __m256i lo = _mm256_add_epi16(back_lo, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(fore_lo, back_lo), weights[2 * i]), 7));
+                const __m256i hi = _mm256_add_epi16(back_hi, _mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(fore_hi, back_hi), weights[2 * i + 1]), 7));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + 32 * i), _mm256_packus_epi16(lo, hi));
+            }
+        }
+
+        key_row_c(key, row, background, width - x);
+    }
+#endif
+
+    key_row_function select_key_row()
+    {
+#ifdef CHROMAKEY_X86
+        if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+            return key_row_avx2;
+
+        if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+            return key_row_sse2;
+#endif
+        return key_row_c;
+    }
+}
+
+ChromaKey::ChromaKey() :
+    m_enabled{ false },
+    m_color{ 0, 177, 64 },
+    m_similarity{ defaultSimilarity },
+    m_smoothness{ defaultSmoothness },
+    m_backgroundValid{ false }
+{}
+
+void ChromaKey::setKey(const QColor &color, const int similarity, const int smoothness)
+{
+    m_color = color;
+    m_similarity = similarity;
+    m_smoothness = smoothness;
+}
+
+void ChromaKey::setBackground(const QImage &image)
+{
+    m_image = image;
+    m_backgroundValid = false;
+}
+
+void ChromaKey::prepare(const FrameView &frame)
+{
+    const std::int32_t height = std::abs(frame.height);
+    const FrameView &view = m_background.view();
+
+    if (m_backgroundValid && view.width == frame.width && view.height == height)
+        return;
+
+    m_background.allocate(PixelLayout::BGRA, frame.width, height);
+    QImage target{ m_background.view().data[0], frame.width, height, m_background.view().stride[0], QImage::Format_RGB32 };
+    target.fill(QColor{ 32, 32, 32 });
+
+    if (!m_image.isNull()) {
+        const QImage scaled = m_image.scaled(target.size(), Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+        QPainter painter{ &target };
+        painter.drawImage(QPoint{ (frame.width - scaled.width()) / 2, (height - scaled.height()) / 2 }, scaled);
+    }
+
+    m_backgroundValid = true;
+}
+
+void ChromaKey::process(const FrameView &frame, const std::int32_t first, const std::int32_t count)
+{
+    static const key_row_function key_row = select_key_row();
+
+    // Same matrix the output is encoded with
+    const Key key = std::abs(frame.height) >= 720
+        ? make_key<ColorMatrix::BT709>(m_color, m_similarity, m_smoothness)
+        : make_key<ColorMatrix::BT601>(m_color, m_similarity, m_smoothness);
+    const FrameView &background = m_background.view();
+
+    for (std::int32_t y = first; y < first + count; ++y) {
+        key_row(
+            key,
+            frame.data[0] + std::ptrdiff_t(y) * frame.stride[0],
+            background.data[0] + std::ptrdiff_t(y) * background.stride[0],
+            frame.width);
+    }
+}
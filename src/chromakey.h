@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QColor>
+#include <QImage>
+
+#include "colorconversion.h"
+#include "framebuffer.h"
+#include "videofilter.h"
+
+// Replaces the key color of the camera frame with a backdrop image. The
+// mask is the distance to the key in the UV plane, so it ignores how light
+// or dark the screen is, and it is blended into the frame in the same pass
+// that computes it. The backdrop is scaled to the frame size only once.
+class ChromaKey : public VideoFilter
+{
+public:
+    ChromaKey();
+
+    Access access() const override { return Access::PerPixel; }
+    bool isEnabled() const override { return m_enabled; }
+    void setEnabled(const bool enabled) { m_enabled = enabled; }
+
+    QColor color() const { return m_color; }
+    // Distances are in 8 bit chroma units: fully keyed up to similarity,
+    // then fading to the camera over smoothness
+    void setKey(const QColor &color, const int similarity, const int smoothness);
+    void setBackground(const QImage &image);
+
+    void prepare(const FrameView &frame) override;
+    void process(const FrameView &frame, const std::int32_t first, const std::int32_t count) override;
+
+private:
+    bool m_enabled;
+    QColor m_color;
+    int m_similarity;
+    int m_smoothness;
+    QImage m_image;
+    AlignedFrameBuffer m_background;
+    bool m_backgroundValid;
+
+};
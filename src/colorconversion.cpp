@@ -0,0 +1,508 @@
+#include "colorconversion.h"
+
+#include <libyuv.h>
+
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COLORCONVERSION_X86
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+#endif
+
+namespace
+{
+    enum class Kernels
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    inline std::uint8_t clamp8(const int value)
+    {
+        return std::uint8_t(value < 0 ? 0 : value > 255 ? 255 : value);
+    }
+
+    // Reference kernels, the vector ones produce the very same bytes
+    template <typename C>
+    void luma_row(const std::uint8_t *bgra, std::uint8_t *y, const std::int32_t width)
+    {
+        for (std::int32_t x = 0; x < width; ++x, bgra += 4)
+            y[x] = clamp8((C::yb * bgra[0] + C::yg * bgra[1] + C::yr * bgra[2] + C::yBias) >> C::shift);
+    }
+
+    // One chroma sample per 2x2 block, u and v are written every step bytes
+    template <typename C>
+    void chroma_row(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v, const int step, const std::int32_t width)
+    {
+        for (std::int32_t x = 0; x < width; x += 2, row0 += 8, row1 += 8, u += step, v += step) {
+            const int next = x + 1 < width ? 4 : 0;
+            const int b = row0[0] + row0[next] + row1[0] + row1[next];
+            const int g = row0[1] + row0[next + 1] + row1[1] + row1[next + 1];
+            const int r = row0[2] + row0[next + 2] + row1[2] + row1[next + 2];
+            *u = clamp8((C::ub * b + C::ug * g + C::ur * r + C::template chromaBias<2>) >> (C::shift + 2));
+            *v = clamp8((C::vb * b + C::vg * g + C::vr * r + C::template chromaBias<2>) >> (C::shift + 2));
+        }
+    }
+
+    // Y0 U Y1 V, chroma of each horizontal pair
+    template <typename C>
+    void yuyv_row(const std::uint8_t *bgra, std::uint8_t *yuyv, const std::int32_t width)
+    {
+        for (std::int32_t x = 0; x < width; x += 2, bgra += 8, yuyv += 4) {
+            const int next = x + 1 < width ? 4 : 0;
+            const int b = bgra[0] + bgra[next];
+            const int g = bgra[1] + bgra[next + 1];
+            const int r = bgra[2] + bgra[next + 2];
+            yuyv[0] = clamp8((C::yb * bgra[0] + C::yg * bgra[1] + C::yr * bgra[2] + C::yBias) >> C::shift);
+            yuyv[1] = clamp8((C::ub * b + C::ug * g + C::ur * r + C::template chromaBias<1>) >> (C::shift + 1));
+            yuyv[2] = clamp8((C::yb * bgra[next] + C::yg * bgra[next + 1] + C::yr * bgra[next + 2] + C::yBias) >> C::shift);
+            yuyv[3] = clamp8((C::vb * b + C::vg * g + C::vr * r + C::template chromaBias<1>) >> (C::shift + 1));
+        }
+    }
+
+#ifdef COLORCONVERSION_X86
+    // Every pixel is widened to 16 bits and madd with the coefficients
+    // leaves two partial sums of it, so all products keep the 15 bit
+    // precision of the scalar kernels. Results are within 0..255 before
+    // the saturating packs, which then behave like clamp8.
+
+    inline __m128i coefficients_sse2(const int b, const int g, const int r)
+    {
+        return _mm_setr_epi16(short(b), short(g), short(r), 0, short(b), short(g), short(r), 0);
+    }
+
+    // Adds up the int32 pairs of two madd results, keeping pixel order
+    inline __m128i sum_pairs(const __m128i a, const __m128i b)
+    {
+        const __m128 fa = _mm_castsi128_ps(a);
+        const __m128 fb = _mm_castsi128_ps(b);
+
+        return _mm_add_epi32(
+            _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1))));
+    }
+
+    template <typename C>
+    inline __m128i luma4(const __m128i pixels, const __m128i coefficients)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coefficients);
+        const __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coefficients);
+
+        return _mm_srai_epi32(_mm_add_epi32(sum_pairs(low, high), _mm_set1_epi32(C::yBias)), C::shift);
+    }
+
+    template <typename C>
+    inline __m128i luma16(const std::uint8_t *bgra, const __m128i coefficients)
+    {
+        const __m128i y0 = luma4<C>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bgra)), coefficients);
+        const __m128i y1 = luma4<C>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bgra + 16)), coefficients);
+        const __m128i y2 = luma4<C>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bgra + 32)), coefficients);
+        const __m128i y3 = luma4<C>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bgra + 48)), coefficients);
+
+        return _mm_packus_epi16(_mm_packs_epi32(y0, y1), _mm_packs_epi32(y2, y3));
+    }
+
+    // Eight chroma samples from eight widened pixel pairs, which are
+    // already sums of 2^n / 2 pixels each
+    template <typename C, int n>
+    inline __m128i chroma8(const __m128i *pairs, const __m128i coefficients)
+    {
+        __m128i sums[2];
+
+        for (int i = 0; i < 2; ++i) {
+            const __m128i *four = pairs + 4 * i;
+            const __m128i pixels01 = sum_pairs(_mm_madd_epi16(four[0], coefficients), _mm_madd_epi16(four[1], coefficients));
+            const __m128i pixels23 = sum_pairs(_mm_madd_epi16(four[2], coefficients), _mm_madd_epi16(four[3], coefficients));
+            sums[i] = _mm_add_epi32(sum_pairs(pixels01, pixels23), _mm_set1_epi32(C::template chromaBias<n>));
+            sums[i] = _mm_srai_epi32(sums[i], C::shift + n);
+        }
+
+        return _mm_packs_epi32(sums[0], sums[1]);
+    }
+
+    // 16 pixels a step, returns how far they got and leaves the tail to the scalar kernels
+    template <typename C>
+    std::int32_t luma_row_sse2(const std::uint8_t *bgra, std::uint8_t *y, const std::int32_t width)
+    {
+        const __m128i coefficients = coefficients_sse2(C::yb, C::yg, C::yr);
+        std::int32_t x = 0;
+
+        for (; x + 16 <= width; x += 16)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(y + x), luma16<C>(bgra + std::ptrdiff_t(x) * 4, coefficients));
+
+        return x;
+    }
+
+    template <typename C, bool Interleaved>
+    std::int32_t chroma_row_sse2(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v, const std::int32_t width)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i uCoefficients = coefficients_sse2(C::ub, C::ug, C::ur);
+        const __m128i vCoefficients = coefficients_sse2(C::vb, C::vg, C::vr);
+        std::int32_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            __m128i pairs[8];
+
+            // Both rows are widened and added first
+            for (int i = 0; i < 4; ++i) {
+                const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + std::ptrdiff_t(x) * 4 + 16 * i));
+                const __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + std::ptrdiff_t(x) * 4 + 16 * i));
+                pairs[2 * i] = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+                pairs[2 * i + 1] = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+            }
+
+            const __m128i uv = _mm_packus_epi16(chroma8<C, 2>(pairs, uCoefficients), chroma8<C, 2>(pairs, vCoefficients));
+
+            if (Interleaved) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x), _mm_unpacklo_epi8(uv, _mm_srli_si128(uv, 8)));
+            } else {
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(u + x / 2), uv);
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(v + x / 2), _mm_srli_si128(uv, 8));
+            }
+        }
+
+        return x;
+    }
+
+    template <typename C>
+    std::int32_t yuyv_row_sse2(const std::uint8_t *bgra, std::uint8_t *yuyv, const std::int32_t width)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i yCoefficients = coefficients_sse2(C::yb, C::yg, C::yr);
+        const __m128i uCoefficients = coefficients_sse2(C::ub, C::ug, C::ur);
+        const __m128i vCoefficients = coefficients_sse2(C::vb, C::vg, C::vr);
+        std::int32_t x = 0;
+
+        for (; x + 16 <= width; x += 16) {
+            const std::uint8_t *src = bgra + std::ptrdiff_t(x) * 4;
+            std::uint8_t *dst = yuyv + std::ptrdiff_t(x) * 2;
+            __m128i pairs[8];
+
+            for (int i = 0; i < 4; ++i) {
+                const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16 * i));
+                pairs[2 * i] = _mm_unpacklo_epi8(pixels, zero);
+                pairs[2 * i + 1] = _mm_unpackhi_epi8(pixels, zero);
+            }
+
+            const __m128i uv = _mm_packus_epi16(chroma8<C, 1>(pairs, uCoefficients), chroma8<C, 1>(pairs, vCoefficients));
+            const __m128i interleaved = _mm_unpacklo_epi8(uv, _mm_srli_si128(uv, 8));
+            const __m128i y = luma16<C>(src, yCoefficients);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_unpacklo_epi8(y, interleaved));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), _mm_unpackhi_epi8(y, interleaved));
+        }
+
+        return x;
+    }
+
+    // Same arithmetic on 8 pixels a register. Unpacks stay within 128 bit
+    // lanes, so the results come out of order and are permuted back once
+    // per store.
+
+    TARGET_AVX2 inline __m256i coefficients_avx2(const int b, const int g, const int r)
+    {
+        return _mm256_broadcastsi128_si256(coefficients_sse2(b, g, r));
+    }
+
+    TARGET_AVX2 inline __m256i sum_pairs_avx2(const __m256i a, const __m256i b)
+    {
+        const __m256 fa = _mm256_castsi256_ps(a);
+        const __m256 fb = _mm256_castsi256_ps(b);
+
+        return _mm256_add_epi32(
+            _mm256_castps_si256(_mm256_shuffle_ps(fa, fb, _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm256_castps_si256(_mm256_shuffle_ps(fa, fb, _MM_SHUFFLE(3, 1, 3, 1))));
+    }
+
+    // Pixels 0 to 3 in the low lane, 4 to 7 in the high one
+    template <typename C>
+    TARGET_AVX2 inline __m256i luma8(const __m256i pixels, const __m256i coefficients)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i low = _mm256_madd_epi16(_mm256_unpacklo_epi8(pixels, zero), coefficients);
+        const __m256i high = _mm256_madd_epi16(_mm256_unpackhi_epi8(pixels, zero), coefficients);
+
+        return _mm256_srai_epi32(_mm256_add_epi32(sum_pairs_avx2(low, high), _mm256_set1_epi32(C::yBias)), C::shift);
+    }
+
+    template <typename C>
+    TARGET_AVX2 inline __m256i luma32(const std::uint8_t *bgra, const __m256i coefficients)
+    {
+        const __m256i y0 = luma8<C>(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(bgra)), coefficients);
+        const __m256i y1 = luma8<C>(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(bgra + 32)), coefficients);
+        const __m256i y2 = luma8<C>(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(bgra + 64)), coefficients);
+        const __m256i y3 = luma8<C>(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(bgra + 96)), coefficients);
+        const __m256i y = _mm256_packus_epi16(_mm256_packs_epi32(y0, y1), _mm256_packs_epi32(y2, y3));
+
+        // Groups of four pixels come out as 0 2 4 6 1 3 5 7
+        return _mm256_permutevar8x32_epi32(y, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+
+    // Sixteen chroma samples from sixteen widened pixel pairs, u samples
+    // in order in the low lane and v samples in the high one
+    template <typename C, int n>
+    TARGET_AVX2 inline __m256i chroma16(const __m256i *pairs, const __m256i uCoefficients, const __m256i vCoefficients)
+    {
+        const __m256i bias = _mm256_set1_epi32(C::template chromaBias<n>);
+        __m256i samples[2];
+
+        for (int plane = 0; plane < 2; ++plane) {
+            const __m256i coefficients = plane == 0 ? uCoefficients : vCoefficients;
+            __m256i sums[2];
+
+            for (int i = 0; i < 2; ++i) {
+                const __m256i *four = pairs + 4 * i;
+                const __m256i pixels01 = sum_pairs_avx2(_mm256_madd_epi16(four[0], coefficients), _mm256_madd_epi16(four[1], coefficients));
+                const __m256i pixels23 = sum_pairs_avx2(_mm256_madd_epi16(four[2], coefficients), _mm256_madd_epi16(four[3], coefficients));
+                sums[i] = _mm256_srai_epi32(_mm256_add_epi32(sum_pairs_avx2(pixels01, pixels23), bias), C::shift + n);
+            }
+
+            samples[plane] = _mm256_packs_epi32(sums[0], sums[1]);
+        }
+
+        // Sample pairs come out as u 01 45 89 1213, v 01 45 89 1213 and
+        // u 23 67 1011 1415, v 23 67 1011 1415 in the other lane
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(samples[0], samples[1]), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i order = _mm256_setr_epi8(
+            0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+            0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+
+        return _mm256_shuffle_epi8(packed, order);
+    }
+
+    template <typename C>
+    TARGET_AVX2 std::int32_t luma_row_avx2(const std::uint8_t *bgra, std::uint8_t *y, const std::int32_t width)
+    {
+        const __m256i coefficients = coefficients_avx2(C::yb, C::yg, C::yr);
+        std::int32_t x = 0;
+
+        for (; x + 32 <= width; x += 32)
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(y + x), luma32<C>(bgra + std::ptrdiff_t(x) * 4, coefficients));
+
+        return x;
+    }
+
+    template <typename C, bool Interleaved>
+    TARGET_AVX2 std::int32_t chroma_row_avx2(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v, const std::int32_t width)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i uCoefficients = coefficients_avx2(C::ub, C::ug, C::ur);
+        const __m256i vCoefficients = coefficients_avx2(C::vb, C::vg, C::vr);
+        std::int32_t x = 0;
+
+        for (; x + 32 <= width; x += 32) {
+            __m256i pairs[8];
+
+            for (int i = 0; i < 4; ++i) {
+                const __m256i top = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + std::ptrdiff_t(x) * 4 + 32 * i));
+                const __m256i bottom = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + std::ptrdiff_t(x) * 4 + 32 * i));
+                pairs[2 * i] = _mm256_add_epi16(_mm256_unpacklo_epi8(top, zero), _mm256_unpacklo_epi8(bottom, zero));
+                pairs[2 * i + 1] = _mm256_add_epi16(_mm256_unpackhi_epi8(top, zero), _mm256_unpackhi_epi8(bottom, zero));
+            }
+
+            const __m256i uv = chroma16<C, 2>(pairs, uCoefficients, vCoefficients);
+            const __m128i us = _mm256_castsi256_si128(uv);
+            const __m128i vs = _mm256_extracti128_si256(uv, 1);
+
+            if (Interleaved) {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x), _mm_unpacklo_epi8(us, vs));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x + 16), _mm_unpackhi_epi8(us, vs));
+            } else {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x / 2), us);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(v + x / 2), vs);
+            }
+        }
+
+        return x;
+    }
+
+    template <typename C>
+    TARGET_AVX2 std::int32_t yuyv_row_avx2(const std::uint8_t *bgra, std::uint8_t *yuyv, const std::int32_t width)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i yCoefficients = coefficients_avx2(C::yb, C::yg, C::yr);
+        const __m256i uCoefficients = coefficients_avx2(C::ub, C::ug, C::ur);
+        const __m256i vCoefficients = coefficients_avx2(C::vb, C::vg, C::vr);
+        std::int32_t x = 0;
+
+        for (; x + 32 <= width; x += 32) {
+            const std::uint8_t *src = bgra + std::ptrdiff_t(x) * 4;
+            std::uint8_t *dst = yuyv + std::ptrdiff_t(x) * 2;
+            __m256i pairs[8];
+
+            for (int i = 0; i < 4; ++i) {
+                const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32 * i));
+                pairs[2 * i] = _mm256_unpacklo_epi8(pixels, zero);
+                pairs[2 * i + 1] = _mm256_unpackhi_epi8(pixels, zero);
+            }
+
+            const __m256i uv = chroma16<C, 1>(pairs, uCoefficients, vCoefficients);
+            const __m128i us = _mm256_castsi256_si128(uv);
+            const __m128i vs = _mm256_extracti128_si256(uv, 1);
+            const __m256i interleaved = _mm256_setr_m128i(_mm_unpacklo_epi8(us, vs), _mm_unpackhi_epi8(us, vs));
+            const __m256i y = luma32<C>(src, yCoefficients);
+            const __m256i low = _mm256_unpacklo_epi8(y, interleaved);
+            const __m256i high = _mm256_unpackhi_epi8(y, interleaved);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permute2x128_si256(low, high, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32), _mm256_permute2x128_si256(low, high, 0x31));
+        }
+
+        return x;
+    }
+#endif
+
+    // Negative height reads the source bottom up
+    inline const std::uint8_t *source_row(const FrameView &bgra, const std::int32_t y)
+    {
+        const std::int32_t height = std::abs(bgra.height);
+        return bgra.data[0] + std::ptrdiff_t(bgra.height < 0 ? height - 1 - y : y) * bgra.stride[0];
+    }
+
+    template <typename C, Kernels K>
+    void convert_luma_row(const std::uint8_t *bgra, std::uint8_t *y, const std::int32_t width)
+    {
+        std::int32_t x = 0;
+#ifdef COLORCONVERSION_X86
+        if (K == Kernels::AVX2)
+            x = luma_row_avx2<C>(bgra, y, width);
+        else if (K == Kernels::SSE2)
+            x = luma_row_sse2<C>(bgra, y, width);
+#endif
+        luma_row<C>(bgra + std::ptrdiff_t(x) * 4, y + x, width - x);
+    }
+
+    template <typename C, bool Interleaved, Kernels K>
+    void convert_chroma_row(const std::uint8_t *row0, const std::uint8_t *row1, std::uint8_t *u, std::uint8_t *v, const std::int32_t width)
+    {
+        const int step = Interleaved ? 2 : 1;
+        std::int32_t x = 0;
+#ifdef COLORCONVERSION_X86
+        if (K == Kernels::AVX2)
+            x = chroma_row_avx2<C, Interleaved>(row0, row1, u, v, width);
+        else if (K == Kernels::SSE2)
+            x = chroma_row_sse2<C, Interleaved>(row0, row1, u, v, width);
+#endif
+        chroma_row<C>(row0 + std::ptrdiff_t(x) * 4, row1 + std::ptrdiff_t(x) * 4, u + x / 2 * step, v + x / 2 * step, step, width - x);
+    }
+
+    template <typename C, bool Interleaved, Kernels K>
+    void bgra_to_420(const FrameView &bgra, const FrameView &yuv)
+    {
+        const std::int32_t width = bgra.width;
+        const std::int32_t height = std::abs(bgra.height);
+
+        for (std::int32_t y = 0; y < height; y += 2) {
+            const bool pair = y + 1 < height;
+            const std::uint8_t *row0 = source_row(bgra, y);
+            const std::uint8_t *row1 = pair ? source_row(bgra, y + 1) : row0;
+
+            convert_luma_row<C, K>(row0, yuv.data[0] + std::ptrdiff_t(y) * yuv.stride[0], width);
+
+            if (pair)
+                convert_luma_row<C, K>(row1, yuv.data[0] + std::ptrdiff_t(y + 1) * yuv.stride[0], width);
+
+            std::uint8_t *u = yuv.data[1] + std::ptrdiff_t(y / 2) * yuv.stride[1];
+            std::uint8_t *v = Interleaved ? u + 1 : yuv.data[2] + std::ptrdiff_t(y / 2) * yuv.stride[2];
+            convert_chroma_row<C, Interleaved, K>(row0, row1, u, v, width);
+        }
+    }
+
+    template <typename C, Kernels K>
+    void bgra_to_yuyv(const FrameView &bgra, const FrameView &yuyv)
+    {
+        const std::int32_t width = bgra.width;
+        const std::int32_t height = std::abs(bgra.height);
+
+        for (std::int32_t y = 0; y < height; ++y) {
+            const std::uint8_t *src = source_row(bgra, y);
+            std::uint8_t *dst = yuyv.data[0] + std::ptrdiff_t(y) * yuyv.stride[0];
+            std::int32_t x = 0;
+#ifdef COLORCONVERSION_X86
+            if (K == Kernels::AVX2)
+                x = yuyv_row_avx2<C>(src, dst, width);
+            else if (K == Kernels::SSE2)
+                x = yuyv_row_sse2<C>(src, dst, width);
+#endif
+            yuyv_row<C>(src + std::ptrdiff_t(x) * 4, dst + std::ptrdiff_t(x) * 2, width - x);
+        }
+    }
+
+    template <PixelLayout Layout, typename C, Kernels K>
+    void bgra_to_yuv(const FrameView &bgra, const FrameView &yuv)
+    {
+        if constexpr (Layout == PixelLayout::YUYV)
+            bgra_to_yuyv<C, K>(bgra, yuv);
+        else
+            bgra_to_420<C, Layout == PixelLayout::NV12, K>(bgra, yuv);
+    }
+
+    struct Converter
+    {
+        PixelLayout layout;
+        ColorMatrix matrix;
+        ColorRange range;
+        // Indexed by Kernels
+        frame_converter convert[3];
+    };
+
+    template <PixelLayout Layout, ColorMatrix Matrix, ColorRange Range>
+    constexpr Converter converter()
+    {
+        using C = Coefficients<Matrix, Range>;
+
+        return { Layout, Matrix, Range, {
+            &bgra_to_yuv<Layout, C, Kernels::Scalar>,
+            &bgra_to_yuv<Layout, C, Kernels::SSE2>,
+            &bgra_to_yuv<Layout, C, Kernels::AVX2>
+        } };
+    }
+
+    const Converter converters[] = {
+        converter<PixelLayout::NV12, ColorMatrix::BT601, ColorRange::Limited>(),
+        converter<PixelLayout::NV12, ColorMatrix::BT601, ColorRange::Full>(),
+        converter<PixelLayout::NV12, ColorMatrix::BT709, ColorRange::Limited>(),
+        converter<PixelLayout::NV12, ColorMatrix::BT709, ColorRange::Full>(),
+        converter<PixelLayout::I420, ColorMatrix::BT601, ColorRange::Limited>(),
+        converter<PixelLayout::I420, ColorMatrix::BT601, ColorRange::Full>(),
+        converter<PixelLayout::I420, ColorMatrix::BT709, ColorRange::Limited>(),
+        converter<PixelLayout::I420, ColorMatrix::BT709, ColorRange::Full>(),
+        converter<PixelLayout::YUYV, ColorMatrix::BT601, ColorRange::Limited>(),
+        converter<PixelLayout::YUYV, ColorMatrix::BT601, ColorRange::Full>(),
+        converter<PixelLayout::YUYV, ColorMatrix::BT709, ColorRange::Limited>(),
+        converter<PixelLayout::YUYV, ColorMatrix::BT709, ColorRange::Full>(),
+    };
+
+    Kernels select_kernels()
+    {
+#ifdef COLORCONVERSION_X86
+        if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+            return Kernels::AVX2;
+
+        if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+            return Kernels::SSE2;
+#endif
+        return Kernels::Scalar;
+    }
+}
+
+frame_converter find_yuv_converter(const PixelLayout layout, const ColorMatrix matrix, const ColorRange range)
+{
+    const Kernels kernels = select_kernels();
+
+    for (const Converter &converter : converters) {
+        if (converter.layout == layout && converter.matrix == matrix && converter.range == range)
+            return converter.convert[int(kernels)];
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "framebuffer.h"
+
+enum class ColorMatrix
+{
+    BT601,
+    BT709
+};
+
+enum class ColorRange
+{
+    Limited,
+    Full
+};
+
+// Fixed point BGR to YUV coefficients, shared by every kernel working in YUV
+constexpr int to_fixed(const double value, const int shift)
+{
+    return int(value * (1 << shift) + (value < 0 ? -0.5 : 0.5));
+}
+
+template <ColorMatrix Matrix, ColorRange Range>
+struct Coefficients
+{
+    static constexpr int shift = 15;
+
+    static constexpr double kr = Matrix == ColorMatrix::BT709 ? 0.2126 : 0.299;
+    static constexpr double kb = Matrix == ColorMatrix::BT709 ? 0.0722 : 0.114;
+    static constexpr double kg = 1 - kr - kb;
+    static constexpr double lumaScale = Range == ColorRange::Limited ? 219.0 / 255 : 1;
+    static constexpr double chromaScale = Range == ColorRange::Limited ? 224.0 / 255 : 1;
+
+    static constexpr int yr = to_fixed(kr * lumaScale, shift);
+    static constexpr int yg = to_fixed(kg * lumaScale, shift);
+    static constexpr int yb = to_fixed(kb * lumaScale, shift);
+    static constexpr int ur = to_fixed(-chromaScale * 0.5 * kr / (1 - kb), shift);
+    static constexpr int ug = to_fixed(-chromaScale * 0.5 * kg / (1 - kb), shift);
+    static constexpr int ub = to_fixed(chromaScale * 0.5, shift);
+    static constexpr int vr = to_fixed(chromaScale * 0.5, shift);
+    static constexpr int vg = to_fixed(-chromaScale * 0.5 * kg / (1 - kr), shift);
+    static constexpr int vb = to_fixed(-chromaScale * 0.5 * kb / (1 - kr), shift);
+
+    // Offsets with rounding, chroma ones for sums of 2^n pixels
+    static constexpr int yBias = ((Range == ColorRange::Limited ? 16 : 0) << shift) + (1 << (shift - 1));
+
+    template <int n>
+    static constexpr int chromaBias = (128 << (shift + n)) + (1 << (shift + n - 1));
+};
+
+// BGRA to YUV conversion for a given matrix and range. Every combination is
+// a separate instantiation of the same kernels with the coefficients known at
+// compile time, so the choice costs nothing per pixel. Returns nullptr for
+// layouts other than NV12, I420 and YUYV.
+frame_converter find_yuv_converter(const PixelLayout layout, const ColorMatrix matrix, const ColorRange range);
@@ -0,0 +1,319 @@
+#include "colorgrade.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTextStream>
+#include <libyuv.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COLORGRADE_X86
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+#endif
+
+namespace
+{
+    // Lattice colors are kept in 12 bits, so after the last lerp a plain
+    // shift lands on 0..255 and every weighted sum fits madd
+    const int entryScale = 255 << 4;
+    const int weightShift = 7;
+    const int maxSize = 256;
+
+    // Cell of 8 shorts: blue, green, red and padding of two colors
+    // next to each other along the red axis
+    const int cellShorts = 8;
+
+    struct Lattice
+    {
+        const std::int16_t *cells;
+        const std::int32_t *offsets;
+        const std::uint32_t *weights;
+        std::int32_t greenStep;
+        std::int32_t blueStep;
+    };
+
+    typedef void (*grade_row_function)(const Lattice &lattice, std::uint8_t *row, const std::int32_t width);
+
+    int lerp(const int a, const int b, const std::uint32_t weights)
+    {
+        return (a * int(weights & 0xffff) + b * int(weights >> 16) + (1 << (weightShift - 1))) >> weightShift;
+    }
+
+    // Reference kernel, the vector ones produce the very same bytes
+    void grade_row_c(const Lattice &lattice, std::uint8_t *row, const std::int32_t width)
+    {
+        for (std::int32_t x = 0; x < width; ++x, row += 4) {
+            const std::int16_t *c00 = lattice.cells + lattice.offsets[row[2]] + lattice.offsets[256 + row[1]] + lattice.offsets[512 + row[0]];
+            const std::int16_t *c10 = c00 + lattice.greenStep;
+            const std::int16_t *c01 = c00 + lattice.blueStep;
+            const std::int16_t *c11 = c01 + lattice.greenStep;
+            const std::uint32_t wr = lattice.weights[row[2]];
+            const std::uint32_t wg = lattice.weights[256 + row[1]];
+            const std::uint32_t wb = lattice.weights[512 + row[0]];
+
+            for (int c = 0; c < 4; ++c) {
+                const int i = 2 * c;
+                const int blue0 = lerp(lerp(c00[i], c00[i + 1], wr), lerp(c10[i], c10[i + 1], wr), wg);
+                const int blue1 = lerp(lerp(c01[i], c01[i + 1], wr), lerp(c11[i], c11[i + 1], wr), wg);
+                row[c] = std::uint8_t((lerp(blue0, blue1, wb) + 8) >> 4);
+            }
+        }
+    }
+
+#ifdef COLORGRADE_X86
+    // One pixel a step: the red lerp is a madd of a cell with the weight
+    // pair, green and blue interleave two results and madd again
+    void grade_row_sse2(const Lattice &lattice, std::uint8_t *row, const std::int32_t width)
+    {
+        const __m128i round = _mm_set1_epi32(1 << (weightShift - 1));
+        const __m128i output_round = _mm_set1_epi32(8);
+
+        for (std::int32_t x = 0; x < width; ++x, row += 4) {
+            const std::int16_t *cell = lattice.cells + lattice.offsets[row[2]] + lattice.offsets[256 + row[1]] + lattice.offsets[512 + row[0]];
+            const __m128i wr = _mm_set1_epi32(int(lattice.weights[row[2]]));
+            const __m128i wg = _mm_set1_epi32(int(lattice.weights[256 + row[1]]));
+            const __m128i wb = _mm_set1_epi32(int(lattice.weights[512 + row[0]]));
+
+            const __m128i c00 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cell));
+            const __m128i c10 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cell + lattice.greenStep));
+            const __m128i c01 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cell + lattice.blueStep));
+            const __m128i c11 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cell + lattice.blueStep + lattice.greenStep));
+
+            const __m128i r00 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(c00, wr), round), weightShift);
+            const __m128i r10 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(c10, wr), round), weightShift);
+            const __m128i r01 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(c01, wr), round), weightShift);
+            const __m128i r11 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(c11, wr), round), weightShift);
+
+            const __m128i green0 = _mm_packs_epi32(r00, r01);
+            const __m128i green1 = _mm_packs_epi32(r10, r11);
+            const __m128i blue0 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(green0, green1), wg), round), weightShift);
+            const __m128i blue1 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(green0, green1), wg), round), weightShift);
+
+            const __m128i blue = _mm_packs_epi32(blue0, blue1);
+            __m128i color = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(blue, _mm_srli_si128(blue, 8)), wb), round), weightShift);
+            color = _mm_srai_epi32(_mm_add_epi32(color, output_round), 4);
+            color = _mm_packus_epi16(_mm_packs_epi32(color, color), color);
+            const int pixel = _mm_cvtsi128_si32(color);
+            std::memcpy(row, &pixel, 4);
+        }
+    }
+
+    TARGET_AVX2 __m256i load_cells(const std::int16_t *first, const std::int16_t *second)
+    {
+        return _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(first))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(second)), 1);
+    }
+
+    TARGET_AVX2 __m256i broadcast_pair(const std::uint32_t first, const std::uint32_t second)
+    {
+        return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi32(int(first))), _mm_set1_epi32(int(second)), 1);
+    }
+
+    // Same steps as SSE2 with a pixel in each 128 bit lane
+    TARGET_AVX2 void grade_row_avx2(const Lattice &lattice, std::uint8_t *row, const std::int32_t width)
+    {
+        const __m256i round = _mm256_set1_epi32(1 << (weightShift - 1));
+        const __m256i output_round = _mm256_set1_epi32(8);
+        std::int32_t x = 0;
+
+        for (; x + 2 <= width; x += 2, row += 8) {
+            const std::int16_t *cell0 = lattice.cells + lattice.offsets[row[2]] + lattice.offsets[256 + row[1]] + lattice.offsets[512 + row[0]];
+            const std::int16_t *cell1 = lattice.cells + lattice.offsets[row[6]] + lattice.offsets[256 + row[5]] + lattice.offsets[512 + row[4]];
+            const __m256i wr = broadcast_pair(lattice.weights[row[2]], lattice.weights[row[6]]);
+            const __m256i wg = broadcast_pair(lattice.weights[256 + row[1]], lattice.weights[256 + row[5]]);
+            const __m256i wb = broadcast_pair(lattice.weights[512 + row[0]], lattice.weights[512 + row[4]]);
+
+            const std::int32_t both = lattice.blueStep + lattice.greenStep;
+            const __m256i c00 = load_cells(cell0, cell1);
+            const __m256i c10 = load_cells(cell0 + lattice.greenStep, cell1 + lattice.greenStep);
+            const __m256i c01 = load_cells(cell0 + lattice.blueStep, cell1 + lattice.blueStep);
+            const __m256i c11 = load_cells(cell0 + both, cell1 + both);
+
+            const __m256i r00 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(c00, wr), round), weightShift);
+            const __m256i r10 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(c10, wr), round), weightShift);
+            const __m256i r01 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(c01, wr), round), weightShift);
+            const __m256i r11 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(c11, wr), round), weightShift);
+
+            const __m256i green0 = _mm256_packs_epi32(r00, r01);
+            const __m256i green1 = _mm256_packs_epi32(r10, r11);
+            const __m256i blue0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(green0, green1), wg), round), weightShift);
+            const __m256i blue1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(green0, green1), wg), round), weightShift);
+
+            const __m256i blue = _mm256_packs_epi32(blue0, blue1);
+            __m256i color = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(blue, _mm256_srli_si256(blue, 8)), wb), round), weightShift);
+            color = _mm256_srai_epi32(_mm256_add_epi32(color, output_round), 4);
+            color = _mm256_packus_epi16(_mm256_packs_epi32(color, color), color);
+            const int pixels[2] = { _mm_cvtsi128_si32(_mm256_castsi256_si128(color)), _mm_cvtsi128_si32(_mm256_extracti128_si256(color, 1)) };
+            std::memcpy(row, pixels, 8);
+        }
+
+        grade_row_c(lattice, row, width - x);
+    }
+#endif
+
+    grade_row_function select_grade_row()
+    {
+#ifdef COLORGRADE_X86
+        if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+            return grade_row_avx2;
+
+        if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+            return grade_row_sse2;
+#endif
+        return grade_row_c;
+    }
+
+    bool parse_triple(const QStringList &fields, float *values)
+    {
+        if (fields.size() != 3)
+            return false;
+
+        bool ok = true;
+
+        for (int i = 0; i < 3 && ok; ++i)
+            values[i] = fields[i].toFloat(&ok);
+
+        return ok;
+    }
+}
+
+ColorGrade::ColorGrade() :
+    m_enabled{ false },
+    m_size{ 0 }
+{}
+
+bool ColorGrade::load(const QString &fileName)
+{
+    QFile file{ fileName };
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qCritical() << "Failed to open color grade" << fileName;
+        return false;
+    }
+
+    QString title = QFileInfo{ fileName }.completeBaseName();
+    int size = 0;
+    float domainMin[3] = { 0, 0, 0 };
+    float domainMax[3] = { 1, 1, 1 };
+    std::vector<float> entries;
+    QTextStream stream{ &file };
+
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        QStringList fields = line.split(' ', Qt::SkipEmptyParts);
+        const QString keyword = fields.takeFirst();
+        bool ok = true;
+
+        if (keyword == "TITLE") {
+            title = line.mid(keyword.size()).trimmed().remove('"');
+        } else if (keyword == "LUT_3D_SIZE") {
+            size = fields.value(0).toInt(&ok);
+            ok = ok && size >= 2 && size <= maxSize;
+            entries.reserve(std::size_t(size) * size * size * 3);
+        } else if (keyword == "DOMAIN_MIN") {
+            ok = parse_triple(fields, domainMin);
+        } else if (keyword == "DOMAIN_MAX") {
+            ok = parse_triple(fields, domainMax);
+        } else if (keyword == "LUT_1D_SIZE" || keyword == "LUT_1D_INPUT_RANGE") {
+            qCritical() << "Only 3D LUTs are supported" << fileName;
+            return false;
+        } else if (keyword == "LUT_3D_INPUT_RANGE") {
+            const float low = fields.value(0).toFloat(&ok);
+            const float high = ok ? fields.value(1).toFloat(&ok) : 0;
+            std::fill(domainMin, domainMin + 3, low);
+            std::fill(domainMax, domainMax + 3, high);
+        } else {
+            float color[3];
+            fields.prepend(keyword);
+            ok = parse_triple(fields, color);
+            entries.insert(entries.end(), color, color + 3);
+        }
+
+        if (!ok) {
+            qCritical() << "Invalid line in color grade" << fileName << line;
+            return false;
+        }
+    }
+
+    if (size == 0 || entries.size() != std::size_t(size) * size * size * 3) {
+        qCritical() << "Incomplete color grade" << fileName;
+        return false;
+    }
+
+    // File order has red changing fastest, then green, then blue
+    const auto entry = [&](const int r, const int g, const int b, const int channel) {
+        const float value = entries[((std::size_t(b) * size + g) * size + r) * 3 + channel];
+        return std::int16_t(qRound(std::clamp(value, 0.0f, 1.0f) * entryScale));
+    };
+
+    const int cellsPerRow = size - 1;
+    m_cells.assign(std::size_t(cellsPerRow) * size * size * cellShorts, 0);
+    std::int16_t *cell = m_cells.data();
+
+    for (int b = 0; b < size; ++b) {
+        for (int g = 0; g < size; ++g) {
+            for (int r = 0; r < cellsPerRow; ++r, cell += cellShorts) {
+                for (int side = 0; side < 2; ++side) {
+                    cell[side] = entry(r + side, g, b, 2);
+                    cell[2 + side] = entry(r + side, g, b, 1);
+                    cell[4 + side] = entry(r + side, g, b, 0);
+                    cell[6 + side] = std::int16_t(entryScale);
+                }
+            }
+        }
+    }
+
+    // Steps to the next cell along red, green and blue
+    const std::int32_t steps[3] = { cellShorts, cellShorts * cellsPerRow, cellShorts * cellsPerRow * size };
+    const float weightScale = float(1 << weightShift);
+    m_offsets.resize(3 * 256);
+    m_weights.resize(3 * 256);
+
+    for (int axis = 0; axis < 3; ++axis) {
+        const float range = std::max(domainMax[axis] - domainMin[axis], 1e-6f);
+
+        for (int value = 0; value < 256; ++value) {
+            const float position = std::clamp((value / 255.0f - domainMin[axis]) / range, 0.0f, 1.0f) * cellsPerRow;
+            const int index = std::min(int(position), cellsPerRow - 1);
+            const std::uint32_t weight = std::uint32_t(qRound((position - index) * weightScale));
+            m_offsets[axis * 256 + value] = index * steps[axis];
+            m_weights[axis * 256 + value] = ((1u << weightShift) - weight) | (weight << 16);
+        }
+    }
+
+    m_size = size;
+    m_title = title;
+    return true;
+}
+
+void ColorGrade::process(const FrameView &frame, const std::int32_t first, const std::int32_t count)
+{
+    static const grade_row_function grade_row = select_grade_row();
+    const std::int32_t cellsPerRow = m_size - 1;
+    const Lattice lattice = {
+        m_cells.data(),
+        m_offsets.data(),
+        m_weights.data(),
+        cellShorts * cellsPerRow,
+        cellShorts * cellsPerRow * m_size
+    };
+
+    for (std::int32_t y = first; y < first + count; ++y)
+        grade_row(lattice, frame.data[0] + std::ptrdiff_t(y) * frame.stride[0], frame.width);
+}
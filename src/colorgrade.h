@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QString>
+
+#include "framebuffer.h"
+#include "videofilter.h"
+
+#include <cstdint>
+#include <vector>
+
+// Applies a .cube 3D LUT to the camera frame. The lattice is repacked so
+// that every cell holds a color next to its red neighbor, so one
+// trilinear lookup reads four 16 byte cells instead of eight scattered
+// entries, and lattice positions for every 8 bit input are precomputed.
+class ColorGrade : public VideoFilter
+{
+public:
+    ColorGrade();
+
+    Access access() const override { return Access::PerPixel; }
+    bool isEnabled() const override { return m_enabled && !m_cells.empty(); }
+    void setEnabled(const bool enabled) { m_enabled = enabled; }
+
+    bool isNull() const { return m_cells.empty(); }
+    const QString &title() const { return m_title; }
+    bool load(const QString &fileName);
+
+    void process(const FrameView &frame, const std::int32_t first, const std::int32_t count) override;
+
+private:
+    bool m_enabled;
+    QString m_title;
+    int m_size;
+    std::vector<std::int16_t> m_cells;
+    // Cell offset and weight pair of every input value, for red, green and blue
+    std::vector<std::int32_t> m_offsets;
+    std::vector<std::uint32_t> m_weights;
+
+};
@@ -0,0 +1,105 @@
+#include "controlserver.h"
+
+#include <QDebug>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QRect>
+
+namespace
+{
+    const int staleProbeTimeout = 200;
+    // Far longer than any command, a client sending more without a newline is dropped
+    const qint64 maxLineLength = 4096;
+}
+
+ControlServer::ControlServer(QObject *parent) :
+    QObject(parent),
+    m_server{ new QLocalServer(this) }
+{
+    connect(m_server, &QLocalServer::newConnection, [this]() {
+        while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+            connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+                readCommands(socket);
+            });
+            connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    });
+}
+
+ControlServer::~ControlServer()
+{}
+
+bool ControlServer::listen(const QString &name)
+{
+    if (m_server->listen(name))
+        return true;
+
+    // Socket left behind by an instance that did not exit properly, a running
+    // instance still answers on it and keeps it
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(name);
+
+        if (!probe.waitForConnected(staleProbeTimeout)) {
+            QLocalServer::removeServer(name);
+
+            if (m_server->listen(name))
+                return true;
+        }
+    }
+
+    qCritical() << "Failed to start control server" << m_server->errorString();
+    return false;
+}
+
+void ControlServer::readCommands(QLocalSocket *socket)
+{
+    while (socket->canReadLine()) {
+        const QString line = QString::fromUtf8(socket->readLine()).trimmed();
+        const QString command = line.section(' ', 0, 0);
+        const QString argument = line.section(' ', 1).trimmed();
+
+        if (command == "scene" && !argument.isEmpty()) {
+            emit sceneRequested(argument);
+            socket->write("ok\n");
+        } else if (command == "crop") {
+            const QStringList values = argument.split(' ', Qt::SkipEmptyParts);
+            QList<int> rect;
+
+            for (const QString &value : values) {
+                bool ok = false;
+                const int number = value.toInt(&ok);
+
+                if (ok)
+                    rect.append(number);
+            }
+
+            if (values.isEmpty()) {
+                emit cropRequested({});
+                socket->write("ok\n");
+            } else if (values.size() == 4 && rect.size() == 4) {
+                emit cropRequested(QRect{ rect[0], rect[1], rect[2], rect[3] });
+                socket->write("ok\n");
+            } else {
+                socket->write("error: expected crop <x> <y> <width> <height>\n");
+            }
+        } else if (command == "replay") {
+            bool ok = true;
+            const int seconds = argument.isEmpty() ? 30 : argument.toInt(&ok);
+
+            if (ok && seconds > 0) {
+                emit replayRequested(seconds);
+                socket->write("ok\n");
+            } else {
+                socket->write("error: expected replay [seconds]\n");
+            }
+        } else {
+            socket->write("error: unknown command\n");
+        }
+    }
+
+    if (socket->bytesAvailable() > maxLineLength) {
+        qWarning() << "Control client sent an overlong line, disconnecting";
+        socket->abort();
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QObject>
+
+class QLocalServer;
+class QLocalSocket;
+
+// Line based local control socket, e.g. "scene combat", "crop 320 180 640 360"
+// or "replay 10"
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    ControlServer(QObject *parent = nullptr);
+    ~ControlServer();
+
+    bool listen(const QString &name);
+
+signals:
+    void sceneRequested(const QString &name);
+    // Empty rectangle resets the crop
+    void cropRequested(const QRect &rect);
+    void replayRequested(const int seconds);
+
+private:
+    void readCommands(QLocalSocket *socket);
+
+private:
+    QLocalServer *m_server;
+
+};
@@ -0,0 +1,101 @@
+#include "filterchain.h"
+#include "pipelinemetrics.h"
+#include "videofilter.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QVarLengthArray>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+    // Well under the L2 of anything recent, leaves room for lookup tables
+    const std::int32_t bandBytes = 256 * 1024;
+}
+
+FilterChain::FilterChain(PipelineMetrics *metrics) :
+    m_metrics{ metrics }
+{
+    // The composing thread takes bands too
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+}
+
+void FilterChain::append(const QString &name, VideoFilter *filter)
+{
+    m_stages.append(Stage{ name, filter });
+}
+
+void FilterChain::apply(const FrameView &frame)
+{
+    m_enabled.clear();
+
+    for (Stage &stage : m_stages) {
+        if (stage.filter->isEnabled()) {
+            stage.elapsed = 0;
+            m_enabled.append(&stage);
+        }
+    }
+
+    qsizetype first = 0;
+
+    while (first < m_enabled.size()) {
+        qsizetype last = first + 1;
+
+        if (m_enabled[first]->filter->access() == VideoFilter::Access::PerPixel) {
+            while (last < m_enabled.size() && m_enabled[last]->filter->access() == VideoFilter::Access::PerPixel)
+                ++last;
+        }
+
+        processBands(frame, first, last);
+        first = last;
+    }
+
+    for (const Stage *stage : m_enabled)
+        m_metrics->record(stage->name, stage->elapsed);
+}
+
+void FilterChain::processBands(const FrameView &frame, const qsizetype first, const qsizetype last)
+{
+    const std::int32_t height = std::abs(frame.height);
+    QElapsedTimer timer;
+
+    for (qsizetype i = first; i < last; ++i) {
+        timer.start();
+        m_enabled[i]->filter->prepare(frame);
+        m_enabled[i]->elapsed += timer.nsecsElapsed();
+    }
+
+    if (m_enabled[first]->filter->access() != VideoFilter::Access::PerPixel) {
+        timer.start();
+        m_enabled[first]->filter->process(frame, 0, height);
+        m_enabled[first]->elapsed += timer.nsecsElapsed();
+        return;
+    }
+
+    const std::int32_t bandRows = std::max(1, bandBytes / std::max(1, std::abs(frame.stride[0])));
+    m_bands.clear();
+
+    for (std::int32_t row = 0; row < height; row += bandRows)
+        m_bands.append(row);
+
+    // Every filter of the run is done with a band before the next is read
+    QtConcurrent::blockingMap(&m_pool, m_bands, [&](const std::int32_t row) {
+        const std::int32_t count = std::min(bandRows, height - row);
+        QVarLengthArray<qint64, 8> elapsed;
+        QElapsedTimer bandTimer;
+
+        for (qsizetype i = first; i < last; ++i) {
+            bandTimer.start();
+            m_enabled[i]->filter->process(frame, row, count);
+            elapsed.append(bandTimer.nsecsElapsed());
+        }
+
+        QMutexLocker locker{ &m_mutex };
+
+        for (qsizetype i = first; i < last; ++i)
+            m_enabled[i]->elapsed += elapsed[i - first];
+    });
+}
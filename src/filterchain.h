@@ -0,0 +1,45 @@
+#pragma once
+
+#include "framebuffer.h"
+
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+
+class PipelineMetrics;
+class VideoFilter;
+
+// Runs video filters in order on the camera frame. Each run of adjacent
+// enabled per pixel filters is fused into one pass over bands of rows
+// small enough to stay in L2 between the filters, and the bands are
+// spread over a thread pool. Time spent in every filter is recorded
+// under its name, summed over the threads.
+class FilterChain
+{
+public:
+    FilterChain(PipelineMetrics *metrics);
+
+    // Filters are not owned and must outlive the chain
+    void append(const QString &name, VideoFilter *filter);
+    void apply(const FrameView &frame);
+
+private:
+    struct Stage
+    {
+        QString name;
+        VideoFilter *filter = nullptr;
+        qint64 elapsed = 0;
+    };
+
+    void processBands(const FrameView &frame, const qsizetype first, const qsizetype last);
+
+private:
+    PipelineMetrics *m_metrics;
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    QList<Stage> m_stages;
+    QList<Stage *> m_enabled;
+    QList<std::int32_t> m_bands;
+
+};
@@ -0,0 +1,159 @@
+#include "framebuffer.h"
+
+#include <cstdlib>
+
+#include <libyuv/video_common.h>
+
+namespace
+{
+    std::int32_t align(const std::int32_t value)
+    {
+        const std::int32_t mask = std::int32_t(AlignedFrameBuffer::alignment) - 1;
+        return (value + mask) & ~mask;
+    }
+}
+
+int plane_count(const PixelLayout layout)
+{
+    switch (layout) {
+    case PixelLayout::I420:
+    case PixelLayout::I422:
+        return 3;
+    case PixelLayout::NV12:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+std::int32_t plane_row_bytes(const PixelLayout layout, const int plane, const std::int32_t width)
+{
+    const std::int32_t half_width = (width + 1) / 2;
+
+    switch (layout) {
+    case PixelLayout::BGRA:
+    case PixelLayout::RGBA:
+        return width * 4;
+    case PixelLayout::RGB:
+    case PixelLayout::BGR:
+        return width * 3;
+    case PixelLayout::Gray:
+        return width;
+    case PixelLayout::I420:
+    case PixelLayout::I422:
+        return plane == 0 ? width : half_width;
+    case PixelLayout::NV12:
+        return plane == 0 ? width : half_width * 2;
+    case PixelLayout::YUYV:
+    case PixelLayout::UYVY:
+        return half_width * 4;
+    }
+
+    return 0;
+}
+
+std::int32_t plane_rows(const PixelLayout layout, const int plane, const std::int32_t height)
+{
+    const std::int32_t rows = std::abs(height);
+
+    if (plane > 0 && (layout == PixelLayout::I420 || layout == PixelLayout::NV12))
+        return (rows + 1) / 2;
+    else
+        return rows;
+}
+
+std::size_t packed_size(const PixelLayout layout, const std::int32_t width, const std::int32_t height)
+{
+    std::size_t size = 0;
+
+    for (int i = 0; i < plane_count(layout); ++i)
+        size += std::size_t(plane_row_bytes(layout, i, width)) * plane_rows(layout, i, height);
+
+    return size;
+}
+
+std::uint32_t layout_fourcc(const PixelLayout layout)
+{
+    switch (layout) {
+    case PixelLayout::BGRA:
+        return libyuv::FOURCC_ARGB;
+    case PixelLayout::RGBA:
+        return libyuv::FOURCC_ABGR;
+    case PixelLayout::RGB:
+        return libyuv::FOURCC_RAW;
+    case PixelLayout::BGR:
+        return libyuv::FOURCC_24BG;
+    case PixelLayout::Gray:
+        return libyuv::FOURCC_I400;
+    case PixelLayout::I420:
+        return libyuv::FOURCC_I420;
+    case PixelLayout::I422:
+        return libyuv::FOURCC_I422;
+    case PixelLayout::NV12:
+        return libyuv::FOURCC_NV12;
+    case PixelLayout::YUYV:
+        return libyuv::FOURCC_YUY2;
+    case PixelLayout::UYVY:
+        return libyuv::FOURCC_UYVY;
+    }
+
+    return 0;
+}
+
+FrameView packed_view(const PixelLayout layout, const std::uint8_t *data, const std::int32_t width, const std::int32_t height)
+{
+    FrameView view;
+    view.width = width;
+    view.height = height;
+    // Views are shared by sources and destinations, constness is up to the caller
+    std::uint8_t *plane = const_cast<std::uint8_t *>(data);
+
+    for (int i = 0; i < plane_count(layout); ++i) {
+        view.data[i] = plane;
+        view.stride[i] = plane_row_bytes(layout, i, width);
+        plane += view.stride[i] * plane_rows(layout, i, height);
+    }
+
+    return view;
+}
+
+AlignedFrameBuffer::AlignedFrameBuffer() :
+    m_size{ 0 },
+    m_layout{ PixelLayout::BGRA }
+{}
+
+void AlignedFrameBuffer::allocate(const PixelLayout layout, const std::int32_t width, const std::int32_t height)
+{
+    if (m_data && layout == m_layout && width == m_view.width && height == m_view.height)
+        return;
+
+    FrameView view;
+    view.width = width;
+    view.height = height;
+    std::size_t offsets[3] = {};
+    std::size_t size = 0;
+
+    // Stride is a multiple of the alignment, so every plane stays aligned too
+    for (int i = 0; i < plane_count(layout); ++i) {
+        view.stride[i] = align(plane_row_bytes(layout, i, width));
+        offsets[i] = size;
+        size += std::size_t(view.stride[i]) * plane_rows(layout, i, height);
+    }
+
+    if (size != m_size || !m_data)
+        m_data.reset(new (std::align_val_t{ alignment }) std::uint8_t[size]);
+
+    for (int i = 0; i < plane_count(layout); ++i)
+        view.data[i] = m_data.get() + offsets[i];
+
+    m_size = size;
+    m_layout = layout;
+    m_view = view;
+}
+
+void AlignedFrameBuffer::release()
+{
+    m_data.reset();
+    m_size = 0;
+    m_view = {};
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+// Memory order of the pixel data, see image_formats.h for naming
+enum class PixelLayout
+{
+    BGRA,
+    RGBA,
+    RGB,
+    BGR,
+    Gray,
+    I420,
+    I422,
+    NV12,
+    YUYV,
+    UYVY
+};
+
+// Non-owning view of up to three planes, every plane with its own stride.
+// Passing a negative height to the conversions flips the image vertically.
+struct FrameView
+{
+    std::uint8_t *data[3] = {};
+    std::int32_t stride[3] = {};
+    std::int32_t width = 0;
+    std::int32_t height = 0;
+};
+
+typedef void (*frame_converter)(const FrameView &src, const FrameView &dst);
+
+int plane_count(const PixelLayout layout);
+std::int32_t plane_row_bytes(const PixelLayout layout, const int plane, const std::int32_t width);
+std::int32_t plane_rows(const PixelLayout layout, const int plane, const std::int32_t height);
+std::size_t packed_size(const PixelLayout layout, const std::int32_t width, const std::int32_t height);
+std::uint32_t layout_fourcc(const PixelLayout layout);
+
+// View of tightly packed planes laid out one after another
+FrameView packed_view(const PixelLayout layout, const std::uint8_t *data, const std::int32_t width, const std::int32_t height);
+
+// Frame storage where every plane and every row starts on a 64 byte
+// boundary, so SIMD kernels can use aligned loads on any row
+class AlignedFrameBuffer
+{
+public:
+    static constexpr std::size_t alignment = 64;
+
+    AlignedFrameBuffer();
+
+    bool isNull() const { return !m_data; }
+    std::size_t size() const { return m_size; }
+    PixelLayout layout() const { return m_layout; }
+    const FrameView &view() const { return m_view; }
+
+    // Keeps the current allocation when layout and size did not change
+    void allocate(const PixelLayout layout, const std::int32_t width, const std::int32_t height);
+    void release();
+
+private:
+    struct Deleter
+    {
+        void operator()(std::uint8_t *data) const { ::operator delete[](data, std::align_val_t{ alignment }); }
+    };
+
+    std::unique_ptr<std::uint8_t[], Deleter> m_data;
+    std::size_t m_size;
+    PixelLayout m_layout;
+    FrameView m_view;
+
+};
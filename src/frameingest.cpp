@@ -0,0 +1,260 @@
+#include "frameingest.h"
+
+#include <utility>
+
+#include <QDebug>
+#include <QVideoFrame>
+#include <libyuv.h>
+
+// libyuv names formats after the order in a register, Qt after the order in
+// memory, so Qt BGRA8888 is libyuv ARGB and Qt ARGB8888 is libyuv BGRA.
+
+namespace
+{
+    FrameView resized(FrameView view, const QSize &size)
+    {
+        view.width = size.width();
+        view.height = size.height();
+        return view;
+    }
+}
+
+FrameIngest::FrameIngest() :
+    m_fallbackFormat{ QVideoFrameFormat::Format_Invalid }
+{}
+
+bool FrameIngest::isSupported(const QVideoFrameFormat::PixelFormat format)
+{
+    switch (format) {
+    case QVideoFrameFormat::Format_NV12:
+    case QVideoFrameFormat::Format_NV21:
+    case QVideoFrameFormat::Format_YUYV:
+    case QVideoFrameFormat::Format_UYVY:
+    case QVideoFrameFormat::Format_YUV420P:
+    case QVideoFrameFormat::Format_YV12:
+    case QVideoFrameFormat::Format_BGRA8888:
+    case QVideoFrameFormat::Format_BGRX8888:
+    case QVideoFrameFormat::Format_ARGB8888:
+    case QVideoFrameFormat::Format_XRGB8888:
+    case QVideoFrameFormat::Format_RGBA8888:
+    case QVideoFrameFormat::Format_RGBX8888:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool FrameIngest::ingest(const QVideoFrame &frame)
+{
+    QVideoFrameFormat::PixelFormat format = frame.pixelFormat();
+    bool bottomToTop = frame.surfaceFormat().scanLineDirection() == QVideoFrameFormat::BottomToTop;
+    FrameView source;
+    source.width = frame.width();
+    source.height = frame.height();
+    QImage fallback;
+
+    if (isSupported(format)) {
+        for (int i = 0; i < frame.planeCount(); ++i) {
+            source.data[i] = const_cast<uint8_t *>(frame.bits(i));
+            source.stride[i] = frame.bytesPerLine(i);
+        }
+    } else {
+        if (format != m_fallbackFormat) {
+            qWarning() << "No direct conversion for" << format << "falling back to QVideoFrame::toImage()";
+            m_fallbackFormat = format;
+        }
+
+        fallback = frame.toImage().convertToFormat(QImage::Format_RGB32);
+
+        if (fallback.isNull())
+            return false;
+
+        // RGB32 is BGRA in memory and already upright
+        format = QVideoFrameFormat::Format_BGRX8888;
+        bottomToTop = false;
+        source.data[0] = const_cast<uint8_t *>(fallback.constBits());
+        source.stride[0] = fallback.bytesPerLine();
+        source.width = fallback.width();
+        source.height = fallback.height();
+    }
+
+    return process(format, source, bottomToTop);
+}
+
+bool FrameIngest::adopt(AlignedFrameBuffer &buffer)
+{
+    const FrameTransform &transform = m_transform;
+
+    if (!transform.crop.isEmpty() || transform.zoom > 1 || transform.mirror || transform.rotation != 0)
+        return process(QVideoFrameFormat::Format_BGRX8888, buffer.view(), false);
+
+    std::swap(m_buffer, buffer);
+    const FrameView &view = m_buffer.view();
+    m_image = QImage{ view.data[0], view.width, view.height, view.stride[0], QImage::Format_RGB32 };
+    return true;
+}
+
+bool FrameIngest::process(const QVideoFrameFormat::PixelFormat format, const FrameView &source, const bool bottomToTop)
+{
+    const QSize size{ source.width, source.height };
+    allocate(size);
+
+    QRect crop = cropRect(size);
+    // Mirroring is a vertical flip followed by a 180 degree rotation,
+    // the flip is free during conversion and the rotation may cancel out
+    const int rotation = (((m_transform.rotation / 90) * 90 + (m_transform.mirror ? 180 : 0)) % 360 + 360) % 360;
+    const bool flip = bottomToTop != m_transform.mirror;
+    const QSize transformed = rotation % 180 ? crop.size().transposed() : crop.size();
+    const FrameView output = m_buffer.view();
+
+    // Bottom-up frames are cropped in memory order
+    if (bottomToTop)
+        crop.moveTop(size.height() - crop.bottom() - 1);
+
+    if (rotation == 0 && transformed == size)
+        return convert(format, source, crop, flip, output);
+
+    m_converted.allocate(PixelLayout::BGRA, size.width(), size.height());
+    FrameView current = resized(m_converted.view(), crop.size());
+
+    if (!convert(format, source, crop, flip, current))
+        return false;
+
+    if (rotation != 0) {
+        const bool last = transformed == size;
+
+        if (!last)
+            m_rotated.allocate(PixelLayout::BGRA, size.height(), size.width());
+
+        const FrameView target = last ? output : resized(m_rotated.view(), transformed);
+        libyuv::ARGBRotate(
+            current.data[0], current.stride[0],
+            target.data[0], target.stride[0],
+            current.width, current.height,
+            libyuv::RotationMode(rotation));
+
+        if (last)
+            return true;
+
+        current = target;
+    }
+
+    libyuv::ARGBScale(
+        current.data[0], current.stride[0], current.width, current.height,
+        output.data[0], output.stride[0], output.width, output.height,
+        libyuv::kFilterBilinear);
+    return true;
+}
+
+// Crop is applied by offsetting plane pointers, no pixel is read twice
+bool FrameIngest::convert(
+    const QVideoFrameFormat::PixelFormat format,
+    const FrameView &source,
+    const QRect &crop,
+    const bool flip,
+    const FrameView &target)
+{
+    const int x = crop.x();
+    const int y = crop.y();
+    const int width = crop.width();
+    // Negative height makes libyuv flip while converting
+    const int height = flip ? -crop.height() : crop.height();
+    const auto at = [&source](const int plane, const int offset, const int row) -> const uint8_t * {
+        return source.data[plane] + row * source.stride[plane] + offset;
+    };
+    uint8_t *dst = target.data[0];
+    const int dstStride = target.stride[0];
+    int result = -1;
+
+    switch (format) {
+    case QVideoFrameFormat::Format_NV12:
+        result = libyuv::NV12ToARGB(
+            at(0, x, y), source.stride[0],
+            at(1, x, y / 2), source.stride[1],
+            dst, dstStride, width, height);
+        break;
+    case QVideoFrameFormat::Format_NV21:
+        result = libyuv::NV21ToARGB(
+            at(0, x, y), source.stride[0],
+            at(1, x, y / 2), source.stride[1],
+            dst, dstStride, width, height);
+        break;
+    case QVideoFrameFormat::Format_YUYV:
+        result = libyuv::YUY2ToARGB(at(0, x * 2, y), source.stride[0], dst, dstStride, width, height);
+        break;
+    case QVideoFrameFormat::Format_UYVY:
+        result = libyuv::UYVYToARGB(at(0, x * 2, y), source.stride[0], dst, dstStride, width, height);
+        break;
+    case QVideoFrameFormat::Format_YUV420P:
+        result = libyuv::I420ToARGB(
+            at(0, x, y), source.stride[0],
+            at(1, x / 2, y / 2), source.stride[1],
+            at(2, x / 2, y / 2), source.stride[2],
+            dst, dstStride, width, height);
+        break;
+    case QVideoFrameFormat::Format_YV12:
+        // Same as I420 with the chroma planes swapped
+        result = libyuv::I420ToARGB(
+            at(0, x, y), source.stride[0],
+            at(2, x / 2, y / 2), source.stride[2],
+            at(1, x / 2, y / 2), source.stride[1],
+            dst, dstStride, width, height);
+        break;
+    case QVideoFrameFormat::Format_BGRA8888:
+    case QVideoFrameFormat::Format_BGRX8888:
+        result = libyuv::ARGBCopy(at(0, x * 4, y), source.stride[0], dst, dstStride, width, height);
+        break;
+    case QVideoFrameFormat::Format_ARGB8888:
+    case QVideoFrameFormat::Format_XRGB8888:
+        result = libyuv::BGRAToARGB(at(0, x * 4, y), source.stride[0], dst, dstStride, width, height);
+        break;
+    case QVideoFrameFormat::Format_RGBA8888:
+    case QVideoFrameFormat::Format_RGBX8888:
+        result = libyuv::ABGRToARGB(at(0, x * 4, y), source.stride[0], dst, dstStride, width, height);
+        break;
+    default:
+        break;
+    }
+
+    if (result != 0) {
+        qWarning() << "Failed to convert" << format << "frame";
+        return false;
+    }
+
+    return true;
+}
+
+QRect FrameIngest::cropRect(const QSize &size) const
+{
+    const QRect frame{ QPoint{}, size };
+    QRect crop = m_transform.crop & frame;
+
+    if (crop.isEmpty()) {
+        crop = frame;
+
+        // Quarter turns keep the output aspect ratio instead of stretching
+        if (m_transform.rotation % 180) {
+            crop.setSize(size.transposed().scaled(size, Qt::KeepAspectRatio));
+            crop.moveCenter(frame.center());
+        }
+    }
+
+    if (m_transform.zoom > 1) {
+        const QPoint center = crop.center();
+        crop.setSize((QSizeF(crop.size()) / m_transform.zoom).toSize());
+        crop.moveCenter(center);
+    }
+
+    // Chroma is subsampled by two in both directions
+    return QRect{ crop.x() & ~1, crop.y() & ~1, qMax(2, crop.width() & ~1), qMax(2, crop.height() & ~1) } & frame;
+}
+
+void FrameIngest::allocate(const QSize &size)
+{
+    if (!m_image.isNull() && m_image.size() == size)
+        return;
+
+    m_buffer.allocate(PixelLayout::BGRA, size.width(), size.height());
+    const FrameView &view = m_buffer.view();
+    m_image = QImage{ view.data[0], view.width, view.height, view.stride[0], QImage::Format_RGB32 };
+}
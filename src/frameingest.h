@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QImage>
+#include <QRect>
+#include <QVideoFrameFormat>
+
+#include "framebuffer.h"
+
+class QVideoFrame;
+
+// Geometry applied while a camera frame is ingested
+struct FrameTransform
+{
+    // Source area in frame coordinates, empty for the whole frame
+    QRect crop;
+    qreal zoom = 1;
+    bool mirror = false;
+    // Clockwise, in degrees
+    int rotation = 0;
+};
+
+// Converts mapped camera frames straight into the RGB32 image the overlay
+// is composited on. Planes are read in place with their own strides, so the
+// camera frame is touched once instead of going through toImage().
+// Crop and flips are folded into that conversion, rotation and scaling add
+// one pass each only when they are needed. The output keeps the camera
+// resolution whatever the transform is.
+class FrameIngest
+{
+public:
+    FrameIngest();
+
+    static bool isSupported(const QVideoFrameFormat::PixelFormat format);
+
+    const FrameTransform &transform() const { return m_transform; }
+    // Cheap enough to call every frame, buffers only depend on the frame size
+    void setTransform(const FrameTransform &transform) { m_transform = transform; }
+
+    // Frame has to be mapped for reading
+    bool ingest(const QVideoFrame &frame);
+    // Takes over an already converted BGRA frame, buffer may receive the old one
+    bool adopt(AlignedFrameBuffer &buffer);
+    QImage &image() { return m_image; }
+    const FrameView &view() const { return m_buffer.view(); }
+
+private:
+    bool process(const QVideoFrameFormat::PixelFormat format, const FrameView &source, const bool bottomToTop);
+    bool convert(const QVideoFrameFormat::PixelFormat format, const FrameView &source, const QRect &crop, const bool flip, const FrameView &target);
+    QRect cropRect(const QSize &size) const;
+    void allocate(const QSize &size);
+
+private:
+    FrameTransform m_transform;
+    AlignedFrameBuffer m_buffer;
+    AlignedFrameBuffer m_converted;
+    AlignedFrameBuffer m_rotated;
+    // Wraps m_buffer, rows are padded and aligned for the filters
+    QImage m_image;
+    QVideoFrameFormat::PixelFormat m_fallbackFormat;
+
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "colorconversion.h"
+#include "framebuffer.h"
+
+#include <cstdint>
+
+// Consumer of the converted output frames. Sinks are fed from the frame
+// path, so write() must return quickly and never block on its consumers.
+class FrameSink
+{
+public:
+    virtual ~FrameSink() = default;
+
+    virtual bool start(const PixelLayout layout, const std::int32_t width, const std::int32_t height, const double fps, const ColorMatrix matrix, const ColorRange range) = 0;
+    virtual void stop() = 0;
+    // Frame is only valid during the call
+    virtual void write(const FrameView &frame, const std::uint64_t timestamp) = 0;
+};
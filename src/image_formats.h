@@ -1,5 +1,7 @@
 #pragma once
 
+#include "framebuffer.h"
+
 #include <cmath>
 #include <libyuv.h>
 
@@ -8,276 +10,358 @@
 // For example, libyuv ARGB is referred to as BGRA in function names below.
 
 // Passing a negative height to the functions below flips the image vertically.
+// The FrameView overloads honour per-plane strides, the pointer overloads
+// expect tightly packed planes.
 
 // copy
-static void gray_to_bgra(const uint8_t *gray, uint8_t* bgra, int32_t width, int32_t height) {
+static void gray_to_bgra(const FrameView &gray, const FrameView &bgra) {
     libyuv::J400ToARGB(
-        gray, width,
-        bgra, width * 4,
-        width, height);
+        gray.data[0], gray.stride[0],
+        bgra.data[0], bgra.stride[0],
+        gray.width, gray.height);
+}
+
+static void gray_to_bgra(const uint8_t *gray, uint8_t* bgra, int32_t width, int32_t height) {
+    gray_to_bgra(
+        packed_view(PixelLayout::Gray, gray, width, height),
+        packed_view(PixelLayout::BGRA, bgra, width, height));
 }
 
 // copy
-static void rgb_to_bgra(const uint8_t *rgb, uint8_t* bgra, int32_t width, int32_t height) {
+static void rgb_to_bgra(const FrameView &rgb, const FrameView &bgra) {
     libyuv::RAWToARGB(
-        rgb, width * 3,
-        bgra, width * 4,
-        width, height);
+        rgb.data[0], rgb.stride[0],
+        bgra.data[0], bgra.stride[0],
+        rgb.width, rgb.height);
+}
+
+static void rgb_to_bgra(const uint8_t *rgb, uint8_t* bgra, int32_t width, int32_t height) {
+    rgb_to_bgra(
+        packed_view(PixelLayout::RGB, rgb, width, height),
+        packed_view(PixelLayout::BGRA, bgra, width, height));
 }
 
 // copy
-static void bgra_to_rgba(const uint8_t *bgra, uint8_t* rgba, int32_t width, int32_t height) {
+static void bgra_to_rgba(const FrameView &bgra, const FrameView &rgba) {
     libyuv::ARGBToABGR(
-        bgra, width * 4,
-        rgba, width * 4,
-        width, height);
+        bgra.data[0], bgra.stride[0],
+        rgba.data[0], rgba.stride[0],
+        bgra.width, bgra.height);
+}
+
+static void bgra_to_rgba(const uint8_t *bgra, uint8_t* rgba, int32_t width, int32_t height) {
+    bgra_to_rgba(
+        packed_view(PixelLayout::BGRA, bgra, width, height),
+        packed_view(PixelLayout::RGBA, rgba, width, height));
 }
 
 // copy
-static void bgra_to_bgra(const uint8_t *src, uint8_t* dist, int32_t width, int32_t height) {
+static void bgra_to_bgra(const FrameView &src, const FrameView &dist) {
     libyuv::ARGBCopy(
-        src, width * 4,
-        dist, width * 4,
-        width, height);
+        src.data[0], src.stride[0],
+        dist.data[0], dist.stride[0],
+        src.width, src.height);
+}
+
+static void bgra_to_bgra(const uint8_t *src, uint8_t* dist, int32_t width, int32_t height) {
+    bgra_to_bgra(
+        packed_view(PixelLayout::BGRA, src, width, height),
+        packed_view(PixelLayout::BGRA, dist, width, height));
 }
 
 #define rgba_to_rgba bgra_to_bgra
 
 // horizontal and vertical subsampling and yuv conversion
-static void rgb_to_i420(const uint8_t *rgb, uint8_t* i420, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
-    int32_t half_width = width / 2;
-    int32_t half_height = height / 2;
-
+static void rgb_to_i420(const FrameView &rgb, const FrameView &i420) {
     libyuv::RAWToI420(
-        rgb, width * 3,
-        i420, width,
-        i420 + width * height, half_width,
-        i420 + width * height + half_width * half_height, half_width,
-        width, height_);
+        rgb.data[0], rgb.stride[0],
+        i420.data[0], i420.stride[0],
+        i420.data[1], i420.stride[1],
+        i420.data[2], i420.stride[2],
+        rgb.width, rgb.height);
+}
+
+static void rgb_to_i420(const uint8_t *rgb, uint8_t* i420, int32_t width, int32_t height) {
+    rgb_to_i420(
+        packed_view(PixelLayout::RGB, rgb, width, height),
+        packed_view(PixelLayout::I420, i420, width, height));
 }
 
 // copy
-static void bgr_to_bgra(const uint8_t *bgr, uint8_t* bgra, int32_t width, int32_t height) {
+static void bgr_to_bgra(const FrameView &bgr, const FrameView &bgra) {
     libyuv::RGB24ToARGB(
-        bgr, width * 3,
-        bgra, width * 4,
-        width, height);
+        bgr.data[0], bgr.stride[0],
+        bgra.data[0], bgra.stride[0],
+        bgr.width, bgr.height);
 }
 
-// horizontal and vertical subsampling and yuv conversion
-static void bgr_to_i420(const uint8_t *bgr, uint8_t* i420, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
-    int32_t half_width = width / 2;
-    int32_t half_height = height / 2;
+static void bgr_to_bgra(const uint8_t *bgr, uint8_t* bgra, int32_t width, int32_t height) {
+    bgr_to_bgra(
+        packed_view(PixelLayout::BGR, bgr, width, height),
+        packed_view(PixelLayout::BGRA, bgra, width, height));
+}
 
+// horizontal and vertical subsampling and yuv conversion
+static void bgr_to_i420(const FrameView &bgr, const FrameView &i420) {
     libyuv::RGB24ToI420(
-        bgr, width * 3,
-        i420, width,
-        i420 + width * height, half_width,
-        i420 + width * height + half_width * half_height, half_width,
-        width, height_);
+        bgr.data[0], bgr.stride[0],
+        i420.data[0], i420.stride[0],
+        i420.data[1], i420.stride[1],
+        i420.data[2], i420.stride[2],
+        bgr.width, bgr.height);
+}
+
+static void bgr_to_i420(const uint8_t *bgr, uint8_t* i420, int32_t width, int32_t height) {
+    bgr_to_i420(
+        packed_view(PixelLayout::BGR, bgr, width, height),
+        packed_view(PixelLayout::I420, i420, width, height));
 }
 
 // horizontal and vertical subsampling and yuv conversion
-static void bgra_to_nv12(const uint8_t *bgra, uint8_t* nv12, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
+static void bgra_to_nv12(const FrameView &bgra, const FrameView &nv12) {
     libyuv::ARGBToNV12(
-        bgra, width * 4,
-        nv12, width,
-        nv12 + width * height, width,
-        width, height_);
+        bgra.data[0], bgra.stride[0],
+        nv12.data[0], nv12.stride[0],
+        nv12.data[1], nv12.stride[1],
+        bgra.width, bgra.height);
+}
+
+static void bgra_to_nv12(const uint8_t *bgra, uint8_t* nv12, int32_t width, int32_t height) {
+    bgra_to_nv12(
+        packed_view(PixelLayout::BGRA, bgra, width, height),
+        packed_view(PixelLayout::NV12, nv12, width, height));
 }
 
 // horizontal subsampling and yuv conversion
-static void bgra_to_uyvy(const uint8_t *bgra, uint8_t* uyvy, int32_t width, int32_t height) {
+static void bgra_to_uyvy(const FrameView &bgra, const FrameView &uyvy) {
     libyuv::ARGBToUYVY(
-        bgra, width * 4,
-        uyvy, width * 2,
-        width, height);
+        bgra.data[0], bgra.stride[0],
+        uyvy.data[0], uyvy.stride[0],
+        bgra.width, bgra.height);
 }
 
-// copy
-static void i420_to_nv12(const uint8_t *i420, uint8_t* nv12, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
-    int32_t half_width = width / 2;
-    int32_t half_height = height / 2;
+static void bgra_to_uyvy(const uint8_t *bgra, uint8_t* uyvy, int32_t width, int32_t height) {
+    bgra_to_uyvy(
+        packed_view(PixelLayout::BGRA, bgra, width, height),
+        packed_view(PixelLayout::UYVY, uyvy, width, height));
+}
 
+// copy
+static void i420_to_nv12(const FrameView &i420, const FrameView &nv12) {
     libyuv::I420ToNV12(
-        i420, width,
-        i420 + width * height, half_width,
-        i420 + width * height + half_width * half_height, half_width,
-        nv12, width,
-        nv12 + width * height, width,
-        width, height_);
+        i420.data[0], i420.stride[0],
+        i420.data[1], i420.stride[1],
+        i420.data[2], i420.stride[2],
+        nv12.data[0], nv12.stride[0],
+        nv12.data[1], nv12.stride[1],
+        i420.width, i420.height);
 }
 
-// horizontal and vertical upsampling and yuv conversion
-static void i420_to_bgra(const uint8_t *i420, uint8_t* bgra, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
-    int32_t half_width = width / 2;
-    int32_t half_height = height / 2;
+static void i420_to_nv12(const uint8_t *i420, uint8_t* nv12, int32_t width, int32_t height) {
+    i420_to_nv12(
+        packed_view(PixelLayout::I420, i420, width, height),
+        packed_view(PixelLayout::NV12, nv12, width, height));
+}
 
+// horizontal and vertical upsampling and yuv conversion
+static void i420_to_bgra(const FrameView &i420, const FrameView &bgra) {
     libyuv::I420ToARGB(
-        i420, width,
-        i420 + width * height, half_width,
-        i420 + width * height + half_width * half_height, half_width,
-        bgra, width * 4,
-        width, height_);
+        i420.data[0], i420.stride[0],
+        i420.data[1], i420.stride[1],
+        i420.data[2], i420.stride[2],
+        bgra.data[0], bgra.stride[0],
+        i420.width, i420.height);
 }
 
-// horizontal and vertical upsampling and yuv conversion
-static void i420_to_rgba(const uint8_t *i420, uint8_t* rgba, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
-    int32_t half_width = width / 2;
-    int32_t half_height = height / 2;
+static void i420_to_bgra(const uint8_t *i420, uint8_t* bgra, int32_t width, int32_t height) {
+    i420_to_bgra(
+        packed_view(PixelLayout::I420, i420, width, height),
+        packed_view(PixelLayout::BGRA, bgra, width, height));
+}
 
+// horizontal and vertical upsampling and yuv conversion
+static void i420_to_rgba(const FrameView &i420, const FrameView &rgba) {
     libyuv::I420ToABGR(
-        i420, width,
-        i420 + width * height, half_width,
-        i420 + width * height + half_width * half_height, half_width,
-        rgba, width * 4,
-        width, height_);
+        i420.data[0], i420.stride[0],
+        i420.data[1], i420.stride[1],
+        i420.data[2], i420.stride[2],
+        rgba.data[0], rgba.stride[0],
+        i420.width, i420.height);
 }
 
-// copy
-static void nv12_to_i420(const uint8_t *nv12, uint8_t* i420, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
-    int32_t half_width = width / 2;
-    int32_t half_height = height / 2;
+static void i420_to_rgba(const uint8_t *i420, uint8_t* rgba, int32_t width, int32_t height) {
+    i420_to_rgba(
+        packed_view(PixelLayout::I420, i420, width, height),
+        packed_view(PixelLayout::RGBA, rgba, width, height));
+}
 
+// copy
+static void nv12_to_i420(const FrameView &nv12, const FrameView &i420) {
     libyuv::NV12ToI420(
-        nv12, width,
-        nv12 + width * height, width,
-        i420, width,
-        i420 + width * height, half_width,
-        i420 + width * height + half_width * half_height, half_width,
-        width, height_);
+        nv12.data[0], nv12.stride[0],
+        nv12.data[1], nv12.stride[1],
+        i420.data[0], i420.stride[0],
+        i420.data[1], i420.stride[1],
+        i420.data[2], i420.stride[2],
+        nv12.width, nv12.height);
+}
+
+static void nv12_to_i420(const uint8_t *nv12, uint8_t* i420, int32_t width, int32_t height) {
+    nv12_to_i420(
+        packed_view(PixelLayout::NV12, nv12, width, height),
+        packed_view(PixelLayout::I420, i420, width, height));
 }
 
 // horizontal and vertical upsampling and yuv conversion
-static void nv12_to_bgra(const uint8_t *nv12, uint8_t* bgra, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
+static void nv12_to_bgra(const FrameView &nv12, const FrameView &bgra) {
     libyuv::NV12ToARGB(
-        nv12, width,
-        nv12 + width * height, width,
-        bgra, width * 4,
-        width, height_);
+        nv12.data[0], nv12.stride[0],
+        nv12.data[1], nv12.stride[1],
+        bgra.data[0], bgra.stride[0],
+        nv12.width, nv12.height);
+}
+
+static void nv12_to_bgra(const uint8_t *nv12, uint8_t* bgra, int32_t width, int32_t height) {
+    nv12_to_bgra(
+        packed_view(PixelLayout::NV12, nv12, width, height),
+        packed_view(PixelLayout::BGRA, bgra, width, height));
 }
 
 // horizontal and vertical upsampling and yuv conversion
-static void nv12_to_rgba(const uint8_t *nv12, uint8_t* rgba, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
+static void nv12_to_rgba(const FrameView &nv12, const FrameView &rgba) {
     libyuv::NV12ToABGR(
-        nv12, width,
-        nv12 + width * height, width,
-        rgba, width * 4,
-        width, height_);
+        nv12.data[0], nv12.stride[0],
+        nv12.data[1], nv12.stride[1],
+        rgba.data[0], rgba.stride[0],
+        nv12.width, nv12.height);
 }
 
-// vertical upsampling
-static void i420_to_uyvy(const uint8_t *i420, uint8_t* uyvy, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
-    int32_t half_width = width / 2;
-    int32_t half_height = height / 2;
+static void nv12_to_rgba(const uint8_t *nv12, uint8_t* rgba, int32_t width, int32_t height) {
+    nv12_to_rgba(
+        packed_view(PixelLayout::NV12, nv12, width, height),
+        packed_view(PixelLayout::RGBA, rgba, width, height));
+}
 
+// vertical upsampling
+static void i420_to_uyvy(const FrameView &i420, const FrameView &uyvy) {
     libyuv::I420ToUYVY(
-        i420, width,
-        i420 + width * height, half_width,
-        i420 + width * height + half_width * half_height, half_width,
-        uyvy, width * 2,
-        width, height_);
+        i420.data[0], i420.stride[0],
+        i420.data[1], i420.stride[1],
+        i420.data[2], i420.stride[2],
+        uyvy.data[0], uyvy.stride[0],
+        i420.width, i420.height);
+}
+
+static void i420_to_uyvy(const uint8_t *i420, uint8_t* uyvy, int32_t width, int32_t height) {
+    i420_to_uyvy(
+        packed_view(PixelLayout::I420, i420, width, height),
+        packed_view(PixelLayout::UYVY, uyvy, width, height));
 }
 
 // vertical subsampling
-static void yuyv_to_nv12(const uint8_t *yuyv, uint8_t* nv12, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
+static void yuyv_to_nv12(const FrameView &yuyv, const FrameView &nv12) {
     libyuv::YUY2ToNV12(
-        yuyv, width * 2,
-        nv12, width,
-        nv12 + width * height, width,
-        width, height_);
+        yuyv.data[0], yuyv.stride[0],
+        nv12.data[0], nv12.stride[0],
+        nv12.data[1], nv12.stride[1],
+        yuyv.width, yuyv.height);
 }
 
-// vertical subsampling
-static void yuyv_to_i420(const uint8_t *yuyv, uint8_t* i420, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
-    int32_t half_width = width / 2;
-    int32_t half_height = height / 2;
+static void yuyv_to_nv12(const uint8_t *yuyv, uint8_t* nv12, int32_t width, int32_t height) {
+    yuyv_to_nv12(
+        packed_view(PixelLayout::YUYV, yuyv, width, height),
+        packed_view(PixelLayout::NV12, nv12, width, height));
+}
 
+// vertical subsampling
+static void yuyv_to_i420(const FrameView &yuyv, const FrameView &i420) {
     libyuv::YUY2ToI420(
-        yuyv, width * 2,
-        i420, width,
-        i420 + width * height, half_width,
-        i420 + width * height + half_width * half_height, half_width,
-        width, height_);
+        yuyv.data[0], yuyv.stride[0],
+        i420.data[0], i420.stride[0],
+        i420.data[1], i420.stride[1],
+        i420.data[2], i420.stride[2],
+        yuyv.width, yuyv.height);
 }
 
-// copy
-static void yuyv_to_i422(const uint8_t *yuyv, uint8_t* i422, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
-    int32_t half_width = width / 2;
+static void yuyv_to_i420(const uint8_t *yuyv, uint8_t* i420, int32_t width, int32_t height) {
+    yuyv_to_i420(
+        packed_view(PixelLayout::YUYV, yuyv, width, height),
+        packed_view(PixelLayout::I420, i420, width, height));
+}
 
+// copy
+static void yuyv_to_i422(const FrameView &yuyv, const FrameView &i422) {
     libyuv::YUY2ToI422(
-        yuyv, width * 2,
-        i422, width,
-        i422 + width * height, half_width,
-        i422 + width * height + half_width * height, half_width,
-        width, height_);
+        yuyv.data[0], yuyv.stride[0],
+        i422.data[0], i422.stride[0],
+        i422.data[1], i422.stride[1],
+        i422.data[2], i422.stride[2],
+        yuyv.width, yuyv.height);
+}
+
+static void yuyv_to_i422(const uint8_t *yuyv, uint8_t* i422, int32_t width, int32_t height) {
+    yuyv_to_i422(
+        packed_view(PixelLayout::YUYV, yuyv, width, height),
+        packed_view(PixelLayout::I422, i422, width, height));
 }
 
 // horizontal upsampling and yuv conversion
-static void yuyv_to_bgra(const uint8_t *yuyv, uint8_t* bgra, int32_t width, int32_t height) {
+static void yuyv_to_bgra(const FrameView &yuyv, const FrameView &bgra) {
     libyuv::YUY2ToARGB(
-        yuyv, width * 2,
-        bgra, width * 4,
-        width, height);
+        yuyv.data[0], yuyv.stride[0],
+        bgra.data[0], bgra.stride[0],
+        yuyv.width, yuyv.height);
+}
+
+static void yuyv_to_bgra(const uint8_t *yuyv, uint8_t* bgra, int32_t width, int32_t height) {
+    yuyv_to_bgra(
+        packed_view(PixelLayout::YUYV, yuyv, width, height),
+        packed_view(PixelLayout::BGRA, bgra, width, height));
 }
 
 // vertical subsampling
-static void uyvy_to_nv12(const uint8_t *uyvy, uint8_t* nv12, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
+static void uyvy_to_nv12(const FrameView &uyvy, const FrameView &nv12) {
     libyuv::UYVYToNV12(
-        uyvy, width * 2,
-        nv12, width,
-        nv12 + width * height, width,
-        width, height_);
+        uyvy.data[0], uyvy.stride[0],
+        nv12.data[0], nv12.stride[0],
+        nv12.data[1], nv12.stride[1],
+        uyvy.width, uyvy.height);
 }
 
-// copy
-static void i422_to_uyvy(const uint8_t *i422, uint8_t* uyvy, int32_t width, int32_t height) {
-    int32_t height_ = height;
-    height = std::abs(height);
-    int32_t half_width = width / 2;
+static void uyvy_to_nv12(const uint8_t *uyvy, uint8_t* nv12, int32_t width, int32_t height) {
+    uyvy_to_nv12(
+        packed_view(PixelLayout::UYVY, uyvy, width, height),
+        packed_view(PixelLayout::NV12, nv12, width, height));
+}
 
+// copy
+static void i422_to_uyvy(const FrameView &i422, const FrameView &uyvy) {
     libyuv::I422ToUYVY(
-        i422, width,
-        i422 + width * height, half_width,
-        i422 + width * height + half_width * height, half_width,
-        uyvy, width * 2,
-        width, height_);
+        i422.data[0], i422.stride[0],
+        i422.data[1], i422.stride[1],
+        i422.data[2], i422.stride[2],
+        uyvy.data[0], uyvy.stride[0],
+        i422.width, i422.height);
+}
+
+static void i422_to_uyvy(const uint8_t *i422, uint8_t* uyvy, int32_t width, int32_t height) {
+    i422_to_uyvy(
+        packed_view(PixelLayout::I422, i422, width, height),
+        packed_view(PixelLayout::UYVY, uyvy, width, height));
 }
 
 // horizontal upsampling and yuv conversion
-static void uyvy_to_bgra(const uint8_t *uyvy, uint8_t* bgra, int32_t width, int32_t height) {
+static void uyvy_to_bgra(const FrameView &uyvy, const FrameView &bgra) {
     libyuv::UYVYToARGB(
-        uyvy, width * 2,
-        bgra, width * 4,
-        width, height);
+        uyvy.data[0], uyvy.stride[0],
+        bgra.data[0], bgra.stride[0],
+        uyvy.width, uyvy.height);
+}
+
+static void uyvy_to_bgra(const uint8_t *uyvy, uint8_t* bgra, int32_t width, int32_t height) {
+    uyvy_to_bgra(
+        packed_view(PixelLayout::UYVY, uyvy, width, height),
+        packed_view(PixelLayout::BGRA, bgra, width, height));
 }
 
 static int32_t bgra_frame_size(int32_t width, int32_t height) {
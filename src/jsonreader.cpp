@@ -0,0 +1,296 @@
+#include "jsonreader.h"
+
+#include <cstdint>
+
+namespace
+{
+    void appendUtf8(std::string &out, const std::uint32_t code)
+    {
+        if (code < 0x80) {
+            out += char(code);
+        } else if (code < 0x800) {
+            out += char(0xC0 | (code >> 6));
+            out += char(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += char(0xE0 | (code >> 12));
+            out += char(0x80 | ((code >> 6) & 0x3F));
+            out += char(0x80 | (code & 0x3F));
+        } else {
+            out += char(0xF0 | (code >> 18));
+            out += char(0x80 | ((code >> 12) & 0x3F));
+            out += char(0x80 | ((code >> 6) & 0x3F));
+            out += char(0x80 | (code & 0x3F));
+        }
+    }
+
+    int hexValue(const char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        else if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        else
+            return -1;
+    }
+}
+
+JsonReader::JsonReader(const char *data, const std::size_t size) :
+    m_data{ data },
+    m_end{ data + size },
+    m_error{ false }
+{}
+
+bool JsonReader::beginObject()
+{
+    if (peek() != '{') {
+        skip();
+        return false;
+    }
+
+    ++m_data;
+    return true;
+}
+
+// Returns false once the closing brace was consumed
+bool JsonReader::nextKey(std::string_view &key)
+{
+    if (!nextMember('}'))
+        return false;
+
+    if (peek() != '"') {
+        fail();
+        return false;
+    }
+
+    const char *begin = m_data + 1;
+    skipString();
+    key = std::string_view(begin, std::size_t(m_data - begin - 1));
+    return !m_error && expect(':');
+}
+
+bool JsonReader::beginArray()
+{
+    if (peek() != '[') {
+        skip();
+        return false;
+    }
+
+    ++m_data;
+    return true;
+}
+
+// Returns false once the closing bracket was consumed
+bool JsonReader::nextElement()
+{
+    return nextMember(']');
+}
+
+int JsonReader::readInt()
+{
+    const char c = peek();
+
+    if (c != '-' && (c < '0' || c > '9')) {
+        skip();
+        return 0;
+    }
+
+    const bool negative = c == '-';
+    std::int64_t value = 0;
+
+    if (negative)
+        ++m_data;
+
+    while (m_data < m_end && *m_data >= '0' && *m_data <= '9') {
+        if (value < INT32_MAX)
+            value = value * 10 + (*m_data - '0');
+
+        ++m_data;
+    }
+
+    // Fraction and exponent are truncated
+    skip();
+    return int(negative ? -value : value);
+}
+
+bool JsonReader::readBool()
+{
+    const bool value = peek() == 't';
+    skip();
+    return value;
+}
+
+std::string JsonReader::readString()
+{
+    std::string value;
+
+    if (peek() != '"') {
+        skip();
+        return value;
+    }
+
+    ++m_data;
+
+    while (m_data < m_end && *m_data != '"') {
+        if (*m_data != '\\') {
+            value += *m_data++;
+            continue;
+        }
+
+        if (++m_data >= m_end)
+            break;
+
+        switch (*m_data++) {
+        case 'b': value += '\b'; break;
+        case 'f': value += '\f'; break;
+        case 'n': value += '\n'; break;
+        case 'r': value += '\r'; break;
+        case 't': value += '\t'; break;
+        case 'u': {
+            std::uint32_t code = 0;
+
+            for (int i = 0; i < 4 && m_data < m_end; ++i) {
+                const int digit = hexValue(*m_data++);
+
+                if (digit < 0) {
+                    fail();
+                    return value;
+                }
+
+                code = code * 16 + digit;
+            }
+
+            // Surrogate pair
+            if (code >= 0xD800 && code < 0xDC00 && m_end - m_data >= 6 && m_data[0] == '\\' && m_data[1] == 'u') {
+                int low = 0;
+
+                for (int i = 2; i < 6 && low >= 0; ++i) {
+                    const int digit = hexValue(m_data[i]);
+                    low = digit < 0 ? -1 : low * 16 + digit;
+                }
+
+                if (low >= 0xDC00 && low < 0xE000) {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    m_data += 6;
+                }
+            }
+
+            appendUtf8(value, code);
+            break;
+        }
+        default:
+            value += m_data[-1];
+            break;
+        }
+    }
+
+    if (m_data >= m_end) {
+        fail();
+        return value;
+    }
+
+    ++m_data;
+    return value;
+}
+
+// Skips the next value, containers are walked without being parsed
+void JsonReader::skip()
+{
+    const char c = peek();
+
+    if (c == '"') {
+        skipString();
+    } else if (c == '{' || c == '[') {
+        int depth = 0;
+
+        while (m_data < m_end) {
+            const char current = *m_data;
+
+            if (current == '"') {
+                skipString();
+                continue;
+            }
+
+            ++m_data;
+
+            if (current == '{' || current == '[') {
+                ++depth;
+            } else if (current == '}' || current == ']') {
+                if (--depth == 0)
+                    return;
+            }
+        }
+
+        fail();
+    } else {
+        while (m_data < m_end && *m_data != ',' && *m_data != '}' && *m_data != ']' &&
+            *m_data != ' ' && *m_data != '\t' && *m_data != '\r' && *m_data != '\n')
+            ++m_data;
+    }
+}
+
+char JsonReader::peek()
+{
+    skipWhitespace();
+    return m_data < m_end && !m_error ? *m_data : '\0';
+}
+
+bool JsonReader::expect(const char c)
+{
+    if (peek() != c) {
+        fail();
+        return false;
+    }
+
+    ++m_data;
+    return true;
+}
+
+bool JsonReader::nextMember(const char close)
+{
+    char c = peek();
+
+    if (c == ',') {
+        ++m_data;
+        c = peek();
+    }
+
+    if (c == close) {
+        ++m_data;
+        return false;
+    } else if (c == '\0') {
+        fail();
+        return false;
+    }
+
+    return true;
+}
+
+void JsonReader::skipWhitespace()
+{
+    while (m_data < m_end && (*m_data == ' ' || *m_data == '\t' || *m_data == '\r' || *m_data == '\n'))
+        ++m_data;
+}
+
+// Expects to be positioned on the opening quote, stops after the closing one
+void JsonReader::skipString()
+{
+    ++m_data;
+
+    while (m_data < m_end) {
+        if (*m_data == '\\') {
+            m_data += 2;
+        } else if (*m_data++ == '"') {
+            return;
+        }
+    }
+
+    fail();
+}
+
+void JsonReader::fail()
+{
+    m_error = true;
+    m_data = m_end;
+}
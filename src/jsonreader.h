@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Forward-only pull reader over a JSON document.
+// Nothing is materialized besides the values the caller asks for, every
+// other value is skipped in place. Reads are lenient like QJsonValue: a value
+// of unexpected type is skipped and the default is returned.
+//
+//     reader.readObject([&](std::string_view key) {
+//         if (key != "name")
+//             return false; // skipped by the reader
+//
+//         name = reader.readString();
+//         return true;
+//     });
+class JsonReader
+{
+public:
+    JsonReader(const char *data, const std::size_t size);
+
+    bool hasError() const { return m_error; }
+
+    bool beginObject();
+    bool nextKey(std::string_view &key);
+    bool beginArray();
+    bool nextElement();
+
+    int readInt();
+    bool readBool();
+    std::string readString();
+    void skip();
+
+    // Handler is called for every member and returns whether it consumed the value
+    template <typename Handler>
+    void readObject(Handler handler)
+    {
+        std::string_view key;
+
+        if (beginObject()) {
+            while (nextKey(key)) {
+                if (!handler(key))
+                    skip();
+            }
+        }
+    }
+
+    // Handler is called for every element, elements it left alone are skipped
+    template <typename Handler>
+    void readArray(Handler handler)
+    {
+        if (beginArray()) {
+            while (nextElement()) {
+                const char *position = m_data;
+                handler();
+
+                if (m_data == position)
+                    skip();
+            }
+        }
+    }
+
+private:
+    char peek();
+    bool expect(const char c);
+    bool nextMember(const char close);
+    void skipWhitespace();
+    void skipString();
+    void fail();
+
+private:
+    const char *m_data;
+    const char *m_end;
+    bool m_error;
+
+};
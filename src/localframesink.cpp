@@ -0,0 +1,331 @@
+#include "localframesink.h"
+#include "pipelinemetrics.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+#include <libyuv.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    // Enough for every subscriber to hold a couple of frames while the
+    // writer keeps going
+    const int slotCount = 6;
+    const int maxHeld = 2;
+}
+
+LocalFrameSink::LocalFrameSink(PipelineMetrics *metrics, QObject *parent) :
+    QObject(parent),
+    m_metrics{ metrics },
+    m_server{ -1 },
+    m_notifier{ nullptr },
+    m_layout{ PixelLayout::NV12 },
+    m_matrix{ ColorMatrix::BT601 },
+    m_range{ ColorRange::Limited },
+    m_width{ 0 },
+    m_height{ 0 },
+    m_size{ 0 },
+    m_sequence{ 0 },
+    m_next{ 0 }
+{}
+
+LocalFrameSink::~LocalFrameSink()
+{
+    close();
+    releaseSlots();
+}
+
+bool LocalFrameSink::listen(const QString &name)
+{
+    close();
+
+    const QByteArray path = QFile::encodeName(QDir::temp().filePath(name));
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if (path.size() >= int(sizeof(address.sun_path))) {
+        qCritical() << "Frame socket path is too long" << path;
+        return false;
+    }
+
+    std::memcpy(address.sun_path, path.constData(), path.size());
+    // Clean up after a previous instance that did not exit properly
+    ::unlink(path.constData());
+
+    m_server = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (m_server < 0
+        || ::bind(m_server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0
+        || ::listen(m_server, 8) < 0) {
+        qCritical() << "Failed to start frame socket" << path << std::strerror(errno);
+        close();
+        return false;
+    }
+
+    m_path = QFile::decodeName(path);
+    m_notifier = new QSocketNotifier(m_server, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &LocalFrameSink::accept);
+    return true;
+}
+
+void LocalFrameSink::close()
+{
+    while (!m_subscribers.isEmpty())
+        drop(m_subscribers.first());
+
+    delete m_notifier;
+    m_notifier = nullptr;
+
+    if (m_server >= 0) {
+        ::close(m_server);
+        m_server = -1;
+    }
+
+    if (!m_path.isEmpty()) {
+        ::unlink(QFile::encodeName(m_path).constData());
+        m_path.clear();
+    }
+}
+
+bool LocalFrameSink::start(const PixelLayout layout, const std::int32_t width, const std::int32_t height, const double fps, const ColorMatrix matrix, const ColorRange range)
+{
+    Q_UNUSED(fps);
+    releaseSlots();
+
+    m_layout = layout;
+    m_matrix = matrix;
+    m_range = range;
+    m_width = width;
+    m_height = height;
+    m_size = packed_size(layout, width, height);
+    m_next = 0;
+
+    for (int i = 0; i < slotCount; ++i) {
+        Slot slot;
+        slot.fd = ::memfd_create("dungeon-camera-frame", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+        if (slot.fd < 0 || ::ftruncate(slot.fd, off_t(m_size)) < 0) {
+            qCritical() << "Failed to create frame memory" << std::strerror(errno);
+
+            if (slot.fd >= 0)
+                ::close(slot.fd);
+
+            releaseSlots();
+            return false;
+        }
+
+        // Subscribers can map it without fearing SIGBUS from a truncation
+        ::fcntl(slot.fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+
+        void *data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, slot.fd, 0);
+
+        if (data == MAP_FAILED) {
+            qCritical() << "Failed to map frame memory" << std::strerror(errno);
+            ::close(slot.fd);
+            releaseSlots();
+            return false;
+        }
+
+        slot.data = static_cast<std::uint8_t *>(data);
+        m_slots.append(slot);
+    }
+
+    return true;
+}
+
+void LocalFrameSink::stop()
+{
+    releaseSlots();
+}
+
+void LocalFrameSink::write(const FrameView &frame, const std::uint64_t timestamp)
+{
+    if (m_subscribers.isEmpty() || m_slots.isEmpty())
+        return;
+
+    int slot = -1;
+
+    for (int i = 0; i < m_slots.size() && slot < 0; ++i) {
+        const int index = (m_next + i) % m_slots.size();
+
+        if (m_slots[index].refs == 0)
+            slot = index;
+    }
+
+    // Every slot is still held by someone
+    if (slot < 0) {
+        m_metrics->count("local dropped");
+        return;
+    }
+
+    Slot &target = m_slots[slot];
+    const FrameView packed = packed_view(m_layout, target.data, m_width, m_height);
+
+    for (int i = 0; i < plane_count(m_layout); ++i) {
+        const std::int32_t row_bytes = plane_row_bytes(m_layout, i, m_width);
+        libyuv::CopyPlane(frame.data[i], frame.stride[i], packed.data[i], packed.stride[i], row_bytes, plane_rows(m_layout, i, m_height));
+    }
+
+    target.sequence = ++m_sequence;
+    m_next = (slot + 1) % m_slots.size();
+
+    QList<Subscriber *> failed;
+
+    for (Subscriber *subscriber : m_subscribers) {
+        if (subscriber->held.size() >= maxHeld) {
+            if (!subscriber->skipping)
+                qWarning() << "Frame subscriber" << subscriber->fd << "falls behind, skipping frames";
+
+            subscriber->skipping = true;
+            m_metrics->count("local skipped");
+            continue;
+        }
+
+        subscriber->skipping = false;
+
+        if (!send(subscriber, slot, timestamp))
+            failed.append(subscriber);
+    }
+
+    for (Subscriber *subscriber : failed)
+        drop(subscriber);
+}
+
+void LocalFrameSink::accept()
+{
+    while (true) {
+        const int fd = ::accept4(m_server, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (fd < 0)
+            break;
+
+        Subscriber *subscriber = new Subscriber();
+        subscriber->fd = fd;
+        subscriber->notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(subscriber->notifier, &QSocketNotifier::activated, this, [this, subscriber]() {
+            readReleases(subscriber);
+        });
+        m_subscribers.append(subscriber);
+    }
+}
+
+void LocalFrameSink::readReleases(Subscriber *subscriber)
+{
+    while (true) {
+        std::uint64_t sequence = 0;
+        const ssize_t size = ::recv(subscriber->fd, &sequence, sizeof(sequence), MSG_DONTWAIT);
+
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+
+        if (size <= 0) {
+            drop(subscriber);
+            return;
+        }
+
+        if (size != sizeof(sequence))
+            continue;
+
+        for (int i = 0; i < subscriber->held.size(); ++i) {
+            Slot &slot = m_slots[subscriber->held[i]];
+
+            if (slot.sequence == sequence) {
+                --slot.refs;
+                subscriber->held.removeAt(i);
+                break;
+            }
+        }
+    }
+}
+
+bool LocalFrameSink::send(Subscriber *subscriber, const int slot, const std::uint64_t timestamp)
+{
+    LocalFrameMessage message{};
+    message.magic = magic;
+    message.version = version;
+    message.fourcc = layout_fourcc(m_layout);
+    message.width = m_width;
+    message.height = m_height;
+    message.matrix = m_matrix == ColorMatrix::BT709 ? 709 : 601;
+    message.range = m_range == ColorRange::Full ? 1 : 0;
+    message.size = std::uint32_t(m_size);
+    message.slot = slot;
+    message.sequence = m_slots[slot].sequence;
+    message.timestamp = timestamp;
+
+    std::uint32_t offset = 0;
+
+    for (int i = 0; i < plane_count(m_layout); ++i) {
+        message.offset[i] = offset;
+        message.stride[i] = plane_row_bytes(m_layout, i, m_width);
+        offset += message.stride[i] * plane_rows(m_layout, i, m_height);
+    }
+
+    iovec data{ &message, sizeof(message) };
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr header{};
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    cmsghdr *rights = CMSG_FIRSTHDR(&header);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(rights), &m_slots[slot].fd, sizeof(int));
+
+    if (::sendmsg(subscriber->fd, &header, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        // Socket buffer is full, same as holding too many frames
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            m_metrics->count("local skipped");
+            return true;
+        }
+
+        return false;
+    }
+
+    ++m_slots[slot].refs;
+    subscriber->held.append(slot);
+    return true;
+}
+
+void LocalFrameSink::drop(Subscriber *subscriber)
+{
+    if (!m_subscribers.removeOne(subscriber))
+        return;
+
+    for (const int slot : subscriber->held) {
+        if (slot < m_slots.size())
+            --m_slots[slot].refs;
+    }
+
+    // Might be called from the notifier's own signal
+    subscriber->notifier->setEnabled(false);
+    subscriber->notifier->deleteLater();
+    ::close(subscriber->fd);
+    delete subscriber;
+}
+
+void LocalFrameSink::releaseSlots()
+{
+    // Subscribers keep their own descriptors, unmapping here is safe
+    for (const Slot &slot : m_slots) {
+        ::munmap(slot.data, m_size);
+        ::close(slot.fd);
+    }
+
+    m_slots.clear();
+
+    for (Subscriber *subscriber : m_subscribers)
+        subscriber->held.clear();
+}
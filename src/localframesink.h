@@ -0,0 +1,98 @@
+#pragma once
+
+#include "framesink.h"
+
+#include <QObject>
+#include <QList>
+#include <QString>
+
+class QSocketNotifier;
+class PipelineMetrics;
+
+// Sent for every frame, the memfd holding it is attached as SCM_RIGHTS.
+// Planes are packed at the given offsets; descriptors with the same slot
+// refer to the same memfd, so subscribers may keep the mapping per slot.
+// Matrix is 601 or 709 and range is 1 for full range, as in the virtual
+// camera queue header. Subscribers should check magic and version first.
+struct LocalFrameMessage
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t fourcc;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t matrix;
+    std::uint32_t range;
+    std::uint32_t reserved;
+    std::uint32_t offset[3];
+    std::uint32_t stride[3];
+    std::uint32_t size;
+    std::uint32_t slot;
+    std::uint64_t sequence;
+    std::uint64_t timestamp;
+};
+
+// Pushes output frames to local subscribers over a SOCK_SEQPACKET Unix
+// socket without copying them. Frames live in a ring of memfds and a
+// subscriber releases one by writing its 8 byte sequence back. Slots are
+// only reused once released, subscribers holding too many frames are
+// skipped until they catch up, so the writer never waits for anyone.
+class LocalFrameSink : public QObject, public FrameSink
+{
+    Q_OBJECT
+
+public:
+    static constexpr std::uint32_t magic = 0x4d464344; // "DCFM"
+    static constexpr std::uint32_t version = 1;
+
+    LocalFrameSink(PipelineMetrics *metrics, QObject *parent = nullptr);
+    ~LocalFrameSink();
+
+    // Socket is created in the temporary directory, like QLocalServer does
+    bool listen(const QString &name);
+    void close();
+
+    bool start(const PixelLayout layout, const std::int32_t width, const std::int32_t height, const double fps, const ColorMatrix matrix, const ColorRange range) override;
+    void stop() override;
+    void write(const FrameView &frame, const std::uint64_t timestamp) override;
+
+private:
+    struct Slot
+    {
+        int fd = -1;
+        std::uint8_t *data = nullptr;
+        std::uint64_t sequence = 0;
+        int refs = 0;
+    };
+
+    struct Subscriber
+    {
+        int fd = -1;
+        QSocketNotifier *notifier = nullptr;
+        QList<int> held;
+        bool skipping = false;
+    };
+
+    void accept();
+    void readReleases(Subscriber *subscriber);
+    bool send(Subscriber *subscriber, const int slot, const std::uint64_t timestamp);
+    void drop(Subscriber *subscriber);
+    void releaseSlots();
+
+private:
+    PipelineMetrics *m_metrics;
+    int m_server;
+    QSocketNotifier *m_notifier;
+    QString m_path;
+    QList<Subscriber *> m_subscribers;
+    QList<Slot> m_slots;
+    PixelLayout m_layout;
+    ColorMatrix m_matrix;
+    ColorRange m_range;
+    std::int32_t m_width;
+    std::int32_t m_height;
+    std::size_t m_size;
+    std::uint64_t m_sequence;
+    int m_next;
+
+};
@@ -1,16 +1,36 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
-#include "ui_videooverlay.h"
 #include "virtualoutput.h"
+#include "previewoutput.h"
+#include "sessionrecorder.h"
+#include "replaybuffer.h"
+#include "mjpegdecoder.h"
+#include "pipelinemetrics.h"
 #include "character.h"
+#include "characterpoller.h"
+#include "overlaylayout.h"
+#include "overlayanimation.h"
+#include "overlayscenes.h"
+#include "controlserver.h"
+#include "portraitcache.h"
+#include "party.h"
+#include "partystrip.h"
+#include "pipesink.h"
+#ifdef Q_OS_LINUX
+#include "localframesink.h"
+#endif
 
 #include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
 #include <QtGui/QImage>
 #include <QtGui/QPainter>
-#include <QtGui/QCloseEvent>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtWidgets/QFileDialog>
 #include <QtWidgets/QMessageBox>
 #include <QtMultimediaWidgets/QVideoWidget>
 #include <QtMultimedia/QMediaCaptureSession>
@@ -19,25 +39,70 @@
 #include <QtMultimedia/QVideoFrame>
 #include <QtMultimedia/QVideoFrameFormat>
 #include <QtMultimedia/QMediaDevices>
-#include <QtSvg/QSvgRenderer>
 
 
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
     m_ui{ new Ui::MainWindow() },
-    m_overlayUi{ new Ui::VideoOverlay() },
-    m_overlayWidget{ new QWidget() },
     m_captureSession{ new QMediaCaptureSession(this) },
     m_cameraDevice{ QMediaDevices::defaultVideoInput() },
     m_camera{ new QCamera(m_cameraDevice, this) },
     m_videoSink{ new QVideoSink(this) },
+    m_metrics{ new PipelineMetrics(this) },
+    m_filters{ m_metrics },
+    m_mjpegDecoder{ new MjpegDecoder(m_metrics, this) },
     m_output{ new VirtualOutput(this) },
-    m_character{ new Character(this) }
+    m_preview{ nullptr },
+    m_recorder{ new SessionRecorder(m_metrics, QDir{ QStandardPaths::writableLocation(QStandardPaths::MoviesLocation) }.filePath("Dungeon Camera"), this) },
+    m_replay{ new ReplayBuffer(m_output, this) },
+    m_scenes{ new OverlayScenes(this) },
+    m_controlServer{ new ControlServer(this) },
+    m_network{ new QNetworkAccessManager(this) },
+    m_portraitCache{ new PortraitCache(m_network, this) },
+    m_character{ new Character(m_network, m_portraitCache, "data", this) },
+    m_poller{ new CharacterPoller(m_network, m_character, this) },
+    m_party{ new Party(m_network, m_portraitCache, this) },
+    m_partyStrip{ new PartyStrip(m_party, this) },
+    m_placeholder{ "placeholder.png" },
+    m_characterId{ -1 },
+    m_hitPoints{ -1 }
 {
     m_ui->setupUi(this);
+    m_chromaKey.setBackground(QImage{ "backdrop.png" });
+    m_ui->gradeCheckBox->setEnabled(QFile::exists("grade.cube") && m_colorGrade.load("grade.cube"));
+    // Backdrop is keyed in before the blur and graded with everything else
+    m_filters.append("key", &m_chromaKey);
+    m_filters.append("blur", &m_backgroundBlur);
+    m_filters.append("grade", &m_colorGrade);
+    m_preview = new PreviewOutput(m_ui->videoOutput->videoSink(), this);
     setupOverlay();
 
+    const int replayBudget = qEnvironmentVariableIntValue("DUNGEON_CAMERA_REPLAY_MB");
+
+    if (replayBudget > 0)
+        m_replay->setMemoryBudget(std::size_t(replayBudget) * 1024 * 1024);
+
+#ifdef Q_OS_LINUX
+    // Local tools get frames pushed instead of polling the queue
+    LocalFrameSink *localSink = new LocalFrameSink(m_metrics, this);
+
+    if (localSink->listen("dungeon-camera-frames"))
+        m_output->addSink(localSink);
+#endif
+
+    // e.g. DUNGEON_CAMERA_PIPE=- dungeon-camera | ffmpeg -i - session.mkv
+    const QString pipePath = qEnvironmentVariable("DUNGEON_CAMERA_PIPE");
+
+    if (!pipePath.isEmpty()) {
+        PipeSink *pipeSink = new PipeSink(m_metrics, pipePath, this);
+
+        if (qEnvironmentVariable("DUNGEON_CAMERA_PIPE_FORMAT") == "raw")
+            pipeSink->setFormat(WriteBehindSink::Format::Raw);
+
+        m_output->addSink(pipeSink);
+    }
+
     for (const auto &device : QMediaDevices::videoInputs()) {
         m_ui->cameraComboBox->addItem(device.description());
     }
@@ -60,6 +125,8 @@ MainWindow::MainWindow(QWidget *parent)
     m_captureSession->setVideoSink(m_videoSink);
 
     setupConnections();
+    updateStats(CharacterStats::allNodes);
+    updateCharacter();
     m_character->load();
     m_camera->start();
 }
@@ -67,44 +134,112 @@ MainWindow::MainWindow(QWidget *parent)
 MainWindow::~MainWindow()
 {
     m_camera->stop();
-    delete m_overlayWidget;
-    delete m_overlayUi;
     delete m_ui;
 }
 
-void MainWindow::closeEvent(QCloseEvent *event)
-{
-    m_overlayWidget->close();
-    event->accept();
-}
-
 void MainWindow::processVideoFrame()
 {
     QVideoFrame frame = m_videoSink->videoFrame();
 
-    if (frame.map(QVideoFrame::ReadOnly)) {
-        QImage image = frame.toImage();
-        QPainter painter{ &image };
-        painter.drawImage(0, 0, m_overlay);
-        painter.end();
+    if (!frame.map(QVideoFrame::ReadOnly))
+        return;
+
+#ifdef HAVE_JPEG
+    // MJPEG is decoded on workers and composed once it is its turn
+    if (frame.pixelFormat() == QVideoFrameFormat::Format_Jpeg) {
+        m_mjpegDecoder->submit(frame);
         frame.unmap();
-        QVideoFrameFormat format{
-            image.size(),
-            QVideoFrameFormat::pixelFormatFromImageFormat(image.format())
-        };
-        qInfo() << "Image:" << image.format();
-        qInfo() << "Frame:" << format;
-        QVideoFrame outputFrame{ format };
-        outputFrame.map(QVideoFrame::WriteOnly);
-        memcpy(outputFrame.bits(0), image.bits(), image.sizeInBytes());
-        outputFrame.unmap();
-
-        if (image.format() != QImage::Format_RGB32)
-            image = image.convertToFormat(QImage::Format_RGB32);
-
-        m_ui->videoOutput->videoSink()->setVideoFrame(outputFrame);
-        m_output->send(image.constBits());
+        return;
     }
+#endif
+
+    // Camera planes are converted once, straight into the composited image
+    QElapsedTimer timer;
+    timer.start();
+    const bool ingested = m_ingest.ingest(frame);
+    frame.unmap();
+
+    if (!ingested)
+        return;
+
+    m_metrics->record("ingest", timer.nsecsElapsed());
+    composeFrame();
+}
+
+void MainWindow::composeFrame()
+{
+    m_filters.apply(m_ingest.view());
+
+    QImage &image = m_ingest.image();
+    QPainter painter{ &image };
+    drawOverlay(painter, true);
+    m_scenes->advance();
+    painter.end();
+
+    // Nobody looks at the preview of a minimized or hidden window
+    if (!isMinimized() && m_ui->videoOutput->isVisible()) {
+        QElapsedTimer timer;
+        timer.start();
+
+        if (m_preview->send(m_ingest.view(), m_ui->videoOutput->size() * m_ui->videoOutput->devicePixelRatio()))
+            m_metrics->record("preview", timer.nsecsElapsed());
+    }
+
+    if (m_output->isStarted()) {
+        QElapsedTimer timer;
+        timer.start();
+        m_output->send(m_ingest.view());
+        m_metrics->record("output", timer.nsecsElapsed());
+    }
+}
+
+void MainWindow::drawOverlay(QPainter &painter, const bool animated)
+{
+    // Only blend tiles the scene actually covers
+    if (const auto *scene = m_scenes->acquire()) {
+        for (const QRect &rect : scene->occupancy)
+            painter.drawImage(rect.topLeft(), scene->layout->image(), rect);
+
+        if (animated)
+            scene->animation->draw(painter);
+        else
+            scene->animation->drawSettled(painter);
+    }
+
+    m_partyStrip->draw(painter);
+}
+
+// Composed and converted only when the overlay changes, the output keeps
+// republishing the result while no camera frames arrive
+void MainWindow::updatePlaceholder()
+{
+    if (!m_output->isStarted())
+        return;
+
+    const QSize size(m_output->width(), m_output->height());
+
+    if (m_placeholderBackground.size() != size) {
+        m_placeholderBackground = QImage{ size, QImage::Format_RGB32 };
+        m_placeholderBackground.fill(Qt::black);
+
+        if (!m_placeholder.isNull()) {
+            const QImage scaled = m_placeholder.scaled(size, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+            QPainter painter{ &m_placeholderBackground };
+            painter.drawImage(QPoint{ (size.width() - scaled.width()) / 2, (size.height() - scaled.height()) / 2 }, scaled);
+        }
+    }
+
+    QImage frame = m_placeholderBackground.copy();
+    QPainter painter{ &frame };
+    drawOverlay(painter, false);
+    painter.end();
+
+    FrameView view;
+    view.data[0] = frame.bits();
+    view.stride[0] = frame.bytesPerLine();
+    view.width = frame.width();
+    view.height = frame.height();
+    m_output->setPlaceholder(view);
 }
 
 void MainWindow::toggleStreaming(bool checked)
@@ -112,66 +247,187 @@ void MainWindow::toggleStreaming(bool checked)
     if (checked) {
         const QCameraFormat cameraFormat = m_cameraDevice.videoFormats().first();
         const QSize resolution = cameraFormat.resolution();
-        m_output->start(resolution.width(), resolution.height(), cameraFormat.maxFrameRate());
-    } else
+        // Same order as the output format combo box
+        const PixelLayout formats[] = { PixelLayout::NV12, PixelLayout::I420, PixelLayout::YUYV };
+        const PixelLayout format = formats[qBound(0, m_ui->outputFormatComboBox->currentIndex(), 2)];
+        const ColorRange range = m_ui->fullRangeCheckBox->isChecked() ? ColorRange::Full : ColorRange::Limited;
+        m_output->start(resolution.width(), resolution.height(), cameraFormat.maxFrameRate(), format, range);
+        updatePlaceholder();
+        m_ui->outputFormatComboBox->setEnabled(false);
+        m_ui->fullRangeCheckBox->setEnabled(false);
+    } else {
+        m_ui->outputFormatComboBox->setEnabled(true);
+        m_ui->fullRangeCheckBox->setEnabled(true);
         m_output->stop();
+    }
 }
 
 void MainWindow::setupOverlay()
 {
-    m_overlayUi->setupUi(m_overlayWidget);
-    m_overlayUi->armorClassBadge->load(QString(":/assets/armor.svg"));
-    m_overlayUi->hitPointsBadge->load(QString(":/assets/container.svg"));
-    // Setup widget
-    m_overlayWidget->setAttribute(Qt::WA_DontShowOnScreen);
-    m_overlayWidget->resize(400, 300);
-    m_overlayWidget->show();
+    // Local scenes override bundled ones with the same name
+    const QStringList directories{ ":/assets/scenes", "scenes" };
+
+    for (const QString &path : directories) {
+        QDir directory{ path };
+
+        for (const QFileInfo &info : directory.entryInfoList({ "*.json" }, QDir::Files))
+            m_scenes->load(info.completeBaseName(), info.filePath());
+    }
+
+    m_ui->sceneComboBox->addItems(m_scenes->names());
+    m_scenes->select("default");
+    m_ui->sceneComboBox->setCurrentText(m_scenes->currentName());
+    m_partyStrip->load(":/assets/party.json");
+    m_controlServer->listen("dungeon-camera");
 }
 
 void MainWindow::resizeOverlay(const QSize &size)
 {
-    const double aspect = double(size.width()) / double(size.height());
-    const int height = 300;
-    const int width = 300 * aspect;
-    m_overlayWidget->resize(width, height);
-    m_overlayWidget->updateGeometry();
-    m_overlayWidget->repaint();
-    m_overlay = QImage{ size.width(), size.height(), QImage::Format_ARGB32 };
-    renderOverlay();
+    m_scenes->compile(size);
+    m_partyStrip->compile(size);
+    m_character->setPortraitSize(m_scenes->itemRect("portrait").size());
 }
 
 void MainWindow::renderOverlay()
 {
-    // Redraw widget
-    const double scale = double(m_overlay.height()) / double(m_overlayWidget->height());
-    m_overlay.fill(Qt::transparent);
-    QPainter painter{ &m_overlay };
-    painter.scale(scale, scale);
-    m_overlayWidget->render(&painter, {}, {}, QWidget::DrawChildren);
-    // No transparency in SvgRenderer
-    painter.end();
+    m_scenes->render();
+    updatePlaceholder();
+}
+
+void MainWindow::updateCharacter()
+{
+    if (m_character->id() >= 0)
+        m_ui->characterIdLineEdit->setText(QString::number(m_character->id()));
+
+    m_scenes->setValue("name", m_character->name());
+    m_scenes->setValue("race", m_character->race());
+    m_scenes->setValue("class", m_character->playerClass());
+
+    // Another character, its hit points are not a change to animate
+    if (m_character->id() != m_characterId) {
+        m_characterId = m_character->id();
+        m_hitPoints = m_character->currenthitPoints();
+    }
+
+    renderOverlay();
+}
+
+void MainWindow::updateStats(CharacterStats::ChangeSet changes)
+{
+    if (changes & CharacterStats::bit(CharacterStats::Level))
+        m_scenes->setValue("level", m_character->level());
+
+    if (changes & CharacterStats::bit(CharacterStats::ArmorClass))
+        m_scenes->setValue("armorClass", m_character->armorClass());
+
+    if (changes & CharacterStats::bit(CharacterStats::MaxHitPoints))
+        m_scenes->setValue("maxHitPoints", m_character->maxHitPoints());
+
+    if (changes & CharacterStats::bit(CharacterStats::CurrentHitPoints)) {
+        const int hitPoints = m_character->currenthitPoints();
+        m_scenes->setValue("hitPoints", hitPoints);
+
+        if (m_hitPoints >= 0 && m_hitPoints != hitPoints)
+            m_scenes->hitPointsChanged(m_hitPoints, hitPoints, m_character->maxHitPoints());
+
+        m_hitPoints = hitPoints;
+    }
+
+    renderOverlay();
 }
 
 void MainWindow::setupConnections()
 {
     connect(m_character, &Character::portraitUpdated, [this]() {
-        m_overlayUi->portraitLabel->setPixmap(QPixmap::fromImage(m_character->portrait()));
+        m_scenes->setValue("portrait", m_character->portrait());
         renderOverlay();
     });
-    connect(m_character, &Character::updated, [this]() {
-        m_ui->characterIdLineEdit->setText(QString::number(m_character->id()));
-        m_overlayUi->nameLabel->setText(m_character->name());
-        m_overlayUi->levelLabel->setText(QString("Level %1").arg(m_character->level()));
-        m_overlayUi->raceLabel->setText(m_character->race());
-        m_overlayUi->classLabel->setText(m_character->playerClass());
-        m_overlayUi->armorClassLabel->setText(QString::number(m_character->armorClass()));
-        m_overlayUi->hitPointsLabel->setText(QString::number(m_character->currenthitPoints()));
-        m_overlayUi->maxHitPointsLabel->setText(QString::number(m_character->maxHitPoints()));
-        renderOverlay();
+    connect(m_character, &Character::updated, this, &MainWindow::updateCharacter);
+    connect(m_character, &Character::statsChanged, this, &MainWindow::updateStats);
+
+    connect(m_ui->sceneComboBox, &QComboBox::currentTextChanged, m_scenes, &OverlayScenes::select);
+    connect(m_controlServer, &ControlServer::sceneRequested, m_scenes, &OverlayScenes::select);
+    connect(m_scenes, &OverlayScenes::currentChanged, this, [this](const QString &name) {
+        QSignalBlocker blocker{ m_ui->sceneComboBox };
+        m_ui->sceneComboBox->setCurrentText(name);
+        updatePlaceholder();
     });
 
     connect(m_ui->reloadButton, &QPushButton::clicked, [this]() {
-        m_character->reload(m_ui->characterIdLineEdit->text().toInt());
+        const int id = m_ui->characterIdLineEdit->text().toInt();
+
+        if (m_poller->isActive())
+            m_poller->start(id);
+        else
+            m_character->reload(id);
+    });
+    connect(m_ui->trackCheckBox, &QCheckBox::toggled, [this](bool checked) {
+        if (checked)
+            m_poller->start(m_ui->characterIdLineEdit->text().toInt());
+        else
+            m_poller->stop();
+    });
+    const auto updateTransform = [this]() {
+        FrameTransform transform = m_ingest.transform();
+        transform.mirror = m_ui->mirrorCheckBox->isChecked();
+        transform.rotation = m_ui->rotationComboBox->currentIndex() * 90;
+        transform.zoom = m_ui->zoomSlider->value() / 100.0;
+        m_ingest.setTransform(transform);
+    };
+    connect(m_ui->mirrorCheckBox, &QCheckBox::toggled, this, updateTransform);
+    connect(m_ui->rotationComboBox, &QComboBox::currentIndexChanged, this, updateTransform);
+    connect(m_ui->zoomSlider, &QSlider::valueChanged, this, updateTransform);
+    connect(m_ui->chromaKeyCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        m_chromaKey.setEnabled(checked);
+    });
+    connect(m_ui->backdropButton, &QPushButton::clicked, this, [this]() {
+        const QString fileName = QFileDialog::getOpenFileName(this, "Backdrop", QString(), "Images (*.png *.jpg *.jpeg *.bmp)");
+
+        if (!fileName.isEmpty())
+            m_chromaKey.setBackground(QImage{ fileName });
+    });
+    connect(m_ui->blurCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        m_backgroundBlur.setEnabled(checked);
+    });
+    connect(m_ui->gradeCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        m_colorGrade.setEnabled(checked);
+    });
+    connect(m_ui->gradeButton, &QPushButton::clicked, this, [this]() {
+        const QString fileName = QFileDialog::getOpenFileName(this, "Color grade", QString(), "3D LUT (*.cube)");
+
+        if (fileName.isEmpty())
+            return;
+
+        if (!m_colorGrade.load(fileName)) {
+            QMessageBox::warning(this, "Color grade", "Failed to load " + fileName);
+            return;
+        }
+
+        m_ui->gradeCheckBox->setEnabled(true);
+        m_ui->gradeCheckBox->setToolTip(m_colorGrade.title());
+        m_ui->gradeCheckBox->setChecked(true);
+    });
+    connect(m_controlServer, &ControlServer::cropRequested, this, [this](const QRect &rect) {
+        FrameTransform transform = m_ingest.transform();
+        transform.crop = rect;
+        m_ingest.setTransform(transform);
+    });
+
+    connect(m_ui->partyButton, &QPushButton::clicked, [this]() {
+        QList<int> ids;
+
+        for (const QString &id : m_ui->partyLineEdit->text().split(',', Qt::SkipEmptyParts)) {
+            bool ok = false;
+            const int value = id.trimmed().toInt(&ok);
+
+            if (ok && !ids.contains(value))
+                ids.append(value);
+        }
+
+        if (ids == m_party->ids())
+            m_party->reload();
+        else
+            m_party->setMembers(ids);
     });
     connect(m_ui->actionQuit, &QAction::triggered, qApp, &QCoreApplication::quit);
     connect(m_ui->actionAbout, &QAction::triggered, this, [this]() {
@@ -181,5 +437,30 @@ void MainWindow::setupConnections()
         QMessageBox::aboutQt(this);
     });
     connect(m_ui->actionPlay, &QAction::toggled, this, &MainWindow::toggleStreaming);
+    connect(m_ui->recordCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        if (checked)
+            m_output->addSink(m_recorder);
+        else
+            m_output->removeSink(m_recorder);
+    });
+    connect(m_ui->replayCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        m_ui->replayButton->setEnabled(checked);
+
+        if (checked)
+            m_output->addSink(m_replay);
+        else
+            m_output->removeSink(m_replay);
+    });
+    connect(m_ui->replayButton, &QPushButton::clicked, this, [this]() {
+        m_replay->replay(30);
+    });
+    connect(m_controlServer, &ControlServer::replayRequested, m_replay, &ReplayBuffer::replay);
     connect(m_videoSink, &QVideoSink::videoFrameChanged, this, &MainWindow::processVideoFrame);
+    connect(m_mjpegDecoder, &MjpegDecoder::frameReady, this, [this]() {
+        if (m_mjpegDecoder->takeFrame(m_ingest))
+            composeFrame();
+    });
+    connect(m_metrics, &PipelineMetrics::summaryChanged, this, [this](const QString &summary) {
+        m_ui->statusBar->showMessage(summary);
+    });
 }
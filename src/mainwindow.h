@@ -1,20 +1,40 @@
 #pragma once
 
 #include <QtWidgets/QMainWindow>
+#include <QtGui/QImage>
 #include <QtMultimedia/QCameraDevice>
 
+#include "characterstats.h"
+#include "backgroundblur.h"
+#include "chromakey.h"
+#include "colorgrade.h"
+#include "filterchain.h"
+#include "frameingest.h"
+
 class QMediaCaptureSession;
 class QCamera;
 class QVideoSink;
 class QVideoFrame;
+class QPainter;
+class QNetworkAccessManager;
 class VirtualOutput;
+class PreviewOutput;
+class SessionRecorder;
+class ReplayBuffer;
+class PipelineMetrics;
+class MjpegDecoder;
 class Character;
+class CharacterPoller;
+class PortraitCache;
+class Party;
+class PartyStrip;
+class OverlayScenes;
+class ControlServer;
 
 QT_BEGIN_NAMESPACE
 namespace Ui
 {
     class MainWindow;
-    class VideoOverlay;
 };
 QT_END_NAMESPACE
 
@@ -26,29 +46,49 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
-protected:
-    void closeEvent(QCloseEvent *event);
-
 private slots:
     void processVideoFrame();
     void toggleStreaming(bool checked);
+    void updateCharacter();
+    void updateStats(CharacterStats::ChangeSet changes);
 
 private:
     void setupOverlay();
     void resizeOverlay(const QSize &size);
     void renderOverlay();
     void setupConnections();
+    void composeFrame();
+    void drawOverlay(QPainter &painter, const bool animated);
+    void updatePlaceholder();
 
 private:
     Ui::MainWindow *m_ui;
-    Ui::VideoOverlay *m_overlayUi;
-    QWidget *m_overlayWidget;
     QMediaCaptureSession *m_captureSession;
     QCameraDevice m_cameraDevice;
     QCamera *m_camera;
     QVideoSink *m_videoSink;
+    PipelineMetrics *m_metrics;
+    FrameIngest m_ingest;
+    ChromaKey m_chromaKey;
+    BackgroundBlur m_backgroundBlur;
+    ColorGrade m_colorGrade;
+    FilterChain m_filters;
+    MjpegDecoder *m_mjpegDecoder;
     VirtualOutput *m_output;
-    QImage m_overlay;
+    PreviewOutput *m_preview;
+    SessionRecorder *m_recorder;
+    ReplayBuffer *m_replay;
+    OverlayScenes *m_scenes;
+    ControlServer *m_controlServer;
+    QNetworkAccessManager *m_network;
+    PortraitCache *m_portraitCache;
     Character *m_character;
+    CharacterPoller *m_poller;
+    Party *m_party;
+    PartyStrip *m_partyStrip;
+    QImage m_placeholder;
+    QImage m_placeholderBackground;
+    int m_characterId;
+    int m_hitPoints;
 
 };
@@ -0,0 +1,110 @@
+#include "mjpegdecoder.h"
+#include "framebuffer.h"
+#include "frameingest.h"
+#include "pipelinemetrics.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QThread>
+#include <QVideoFrame>
+#include <QtConcurrent/QtConcurrentRun>
+#include <libyuv.h>
+
+MjpegDecoder::MjpegDecoder(PipelineMetrics *metrics, QObject *parent) :
+    QObject(parent),
+    m_metrics{ metrics },
+    m_submitted{ 0 },
+    m_delivered{ 0 },
+    m_inFlight{ 0 }
+{
+    // Beyond a few workers decode latency only grows
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount() - 1, 4));
+}
+
+MjpegDecoder::~MjpegDecoder()
+{
+    m_pool.waitForDone();
+    qDeleteAll(m_free);
+    qDeleteAll(m_ready);
+
+    for (const Result &result : m_pending)
+        delete result.buffer;
+}
+
+bool MjpegDecoder::submit(const QVideoFrame &frame)
+{
+    if (m_inFlight >= m_pool.maxThreadCount()) {
+        m_metrics->count("mjpeg dropped");
+        return false;
+    }
+
+    // Compressed frame is small, copying it lets the camera buffer go right away
+    const QByteArray sample{ reinterpret_cast<const char *>(frame.bits(0)), frame.mappedBytes(0) };
+    const QSize size = frame.size();
+    AlignedFrameBuffer *buffer = m_free.isEmpty() ? new AlignedFrameBuffer() : m_free.takeLast();
+    const quint64 sequence = m_submitted++;
+    ++m_inFlight;
+
+    auto *watcher = new QFutureWatcher<Result>(this);
+
+    connect(watcher, &QFutureWatcher<Result>::finished, this, [this, watcher, sequence]() {
+        watcher->deleteLater();
+        --m_inFlight;
+        finish(sequence, watcher->result());
+    });
+
+    watcher->setFuture(QtConcurrent::run(&m_pool, [sample, size, buffer]() {
+        QElapsedTimer timer;
+        timer.start();
+        buffer->allocate(PixelLayout::BGRA, size.width(), size.height());
+        const FrameView &view = buffer->view();
+
+#ifdef HAVE_JPEG
+        // Decoding straight to ARGB converts each block while it is still in cache
+        const int status = libyuv::MJPGToARGB(
+            reinterpret_cast<const uint8_t *>(sample.constData()), sample.size(),
+            view.data[0], view.stride[0],
+            view.width, view.height,
+            view.width, view.height);
+#else
+        // Not submitted without libjpeg, see MainWindow::processVideoFrame()
+        const int status = -1;
+#endif
+
+        return Result{ buffer, status == 0, timer.nsecsElapsed() };
+    }));
+
+    return true;
+}
+
+bool MjpegDecoder::takeFrame(FrameIngest &ingest)
+{
+    if (m_ready.isEmpty())
+        return false;
+
+    AlignedFrameBuffer *buffer = m_ready.takeFirst();
+    const bool adopted = ingest.adopt(*buffer);
+    // Buffer may now hold the previous ingest frame, either way it is free
+    m_free.append(buffer);
+    return adopted;
+}
+
+void MjpegDecoder::finish(const quint64 sequence, const Result &result)
+{
+    m_pending.insert(sequence, result);
+
+    while (m_pending.contains(m_delivered)) {
+        const Result next = m_pending.take(m_delivered++);
+        m_metrics->record("decode", next.elapsed);
+
+        if (!next.decoded) {
+            m_metrics->count("mjpeg errors");
+            m_free.append(next.buffer);
+            continue;
+        }
+
+        m_ready.append(next.buffer);
+        emit frameReady();
+    }
+}
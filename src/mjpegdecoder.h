@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QThreadPool>
+
+class QVideoFrame;
+class AlignedFrameBuffer;
+class FrameIngest;
+class PipelineMetrics;
+
+// Decodes MJPEG camera frames on a small pool of its own, several frames
+// at once. Results are handed out strictly in capture order; a frame that
+// arrives while every worker is busy is dropped.
+class MjpegDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    MjpegDecoder(PipelineMetrics *metrics, QObject *parent = nullptr);
+    ~MjpegDecoder();
+
+    // Frame has to be mapped for reading
+    bool submit(const QVideoFrame &frame);
+    // Moves the oldest decoded frame into the ingest stage
+    bool takeFrame(FrameIngest &ingest);
+
+signals:
+    void frameReady();
+
+private:
+    struct Result
+    {
+        AlignedFrameBuffer *buffer = nullptr;
+        bool decoded = false;
+        qint64 elapsed = 0;
+    };
+
+    void finish(const quint64 sequence, const Result &result);
+
+private:
+    PipelineMetrics *m_metrics;
+    QThreadPool m_pool;
+    QList<AlignedFrameBuffer *> m_free;
+    QMap<quint64, Result> m_pending;
+    QList<AlignedFrameBuffer *> m_ready;
+    quint64 m_submitted;
+    quint64 m_delivered;
+    int m_inFlight;
+
+};
@@ -0,0 +1,146 @@
+#include "overlayanimation.h"
+#include "overlaylayout.h"
+
+#include <QPainter>
+#include <QTimer>
+
+namespace
+{
+    // Durations in output frames
+    const int flashFrameCount = 10;
+    const int barFrameCount = 20;
+    const QColor flashColor{ 220, 20, 20 };
+    // Without camera frames nothing advances, static bar comes back after this
+    const int stallTimeout = 1000;
+}
+
+OverlayAnimation::OverlayAnimation(OverlayLayout *layout, QObject *parent) :
+    QObject(parent),
+    m_layout{ layout },
+    m_stallTimer{ new QTimer(this) }
+{
+    m_stallTimer->setSingleShot(true);
+    m_stallTimer->setInterval(stallTimeout);
+    connect(m_stallTimer, &QTimer::timeout, this, [this]() {
+        if (!isRunning())
+            return;
+
+        stop();
+        emit finished();
+    });
+}
+
+OverlayAnimation::~OverlayAnimation()
+{}
+
+bool OverlayAnimation::isRunning() const
+{
+    return m_flash.isRunning() || m_bar.isRunning();
+}
+
+// Bake effects that only depend on the layout, call after every compile
+void OverlayAnimation::prepare()
+{
+    stop();
+    m_flashFrames.clear();
+    m_flash.rect = m_layout->itemRect("hitPointsBadge");
+    const QImage badge = m_layout->renderItem("hitPointsBadge");
+
+    if (badge.isNull())
+        return;
+
+    for (int i = 0; i < flashFrameCount; ++i) {
+        const double fade = 1.0 - double(i) / flashFrameCount;
+        QColor color = flashColor;
+        color.setAlpha(qRound(200 * fade * fade));
+
+        // Tint only the pixels covered by the badge
+        QImage frame = badge;
+        QPainter painter{ &frame };
+        painter.setCompositionMode(QPainter::CompositionMode_SourceIn);
+        painter.fillRect(frame.rect(), color);
+        painter.end();
+        m_flashFrames.append(frame);
+    }
+}
+
+void OverlayAnimation::hitPointsChanged(const int from, const int to, const int max)
+{
+    if (to < from && !m_flashFrames.isEmpty()) {
+        m_flash.frames = m_flashFrames;
+        m_flash.position = 0;
+    }
+
+    m_bar.rect = m_layout->itemRect("hitPointsBar");
+
+    if (m_bar.rect.isEmpty())
+        return;
+
+    // Change in the middle of an animation continues from what is shown
+    const double start = m_bar.isRunning() ? m_barValues[m_bar.position] : from;
+    m_bar.frames.clear();
+    m_barValues.clear();
+
+    for (int i = 1; i <= barFrameCount; ++i) {
+        const double t = double(i) / barFrameCount;
+        const double eased = 1.0 - (1.0 - t) * (1.0 - t);
+        const double value = start + (to - start) * eased;
+        m_barValues.append(value);
+        m_bar.frames.append(m_layout->renderItem("hitPointsBar", {
+            { "hitPoints", value },
+            { "maxHitPoints", max }
+        }));
+    }
+
+    // Static bar is hidden until the last interpolated frame was shown
+    m_bar.position = 0;
+    m_layout->setVisible("hitPointsBar", false);
+    m_stallTimer->start();
+}
+
+// Returns true when the layout has to be rendered again
+bool OverlayAnimation::advance()
+{
+    if (m_flash.isRunning())
+        ++m_flash.position;
+
+    if (m_bar.isRunning()) {
+        ++m_bar.position;
+
+        if (!m_bar.isRunning()) {
+            m_layout->setVisible("hitPointsBar", true);
+            return true;
+        }
+    }
+
+    if (isRunning())
+        m_stallTimer->start();
+
+    return false;
+}
+
+void OverlayAnimation::draw(QPainter &painter) const
+{
+    if (m_bar.isRunning())
+        painter.drawImage(m_bar.rect.topLeft(), m_bar.frames[m_bar.position]);
+
+    if (m_flash.isRunning())
+        painter.drawImage(m_flash.rect.topLeft(), m_flash.frames[m_flash.position]);
+}
+
+void OverlayAnimation::drawSettled(QPainter &painter) const
+{
+    if (m_bar.isRunning())
+        painter.drawImage(m_bar.rect.topLeft(), m_bar.frames.last());
+}
+
+void OverlayAnimation::stop()
+{
+    m_stallTimer->stop();
+    m_flash.position = -1;
+
+    if (m_bar.isRunning())
+        m_layout->setVisible("hitPointsBar", true);
+
+    m_bar.position = -1;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QObject>
+#include <QImage>
+#include <QList>
+#include <QRect>
+
+class QPainter;
+class QTimer;
+class OverlayLayout;
+
+// Short overlay effects rasterized into tiles up front, so playing them
+// back costs a single blit per output frame
+class OverlayAnimation : public QObject
+{
+    Q_OBJECT
+
+public:
+    OverlayAnimation(OverlayLayout *layout, QObject *parent = nullptr);
+    ~OverlayAnimation();
+
+    bool isRunning() const;
+    void prepare();
+    void hitPointsChanged(const int from, const int to, const int max);
+    bool advance();
+    void draw(QPainter &painter) const;
+    // End state of a running animation, for frames that are not played back
+    void drawSettled(QPainter &painter) const;
+
+signals:
+    // Stalled animation was cut short, the layout has to be rendered again
+    void finished();
+
+private:
+    struct Sequence
+    {
+        QRect rect;
+        QList<QImage> frames;
+        int position = -1;
+
+        bool isRunning() const { return position >= 0 && position < frames.size(); }
+    };
+
+    void stop();
+
+private:
+    OverlayLayout *m_layout;
+    QList<QImage> m_flashFrames;
+    Sequence m_flash;
+    Sequence m_bar;
+    QList<double> m_barValues;
+    QTimer *m_stallTimer;
+
+};
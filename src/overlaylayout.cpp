@@ -0,0 +1,323 @@
+#include "overlaylayout.h"
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QRegularExpression>
+#include <QSvgRenderer>
+
+namespace
+{
+    Qt::Alignment parseAlignment(const QString &name)
+    {
+        if (name == "center")
+            return Qt::AlignCenter;
+        else if (name == "right")
+            return Qt::AlignRight | Qt::AlignVCenter;
+        else
+            return Qt::AlignLeft | Qt::AlignVCenter;
+    }
+}
+
+OverlayLayout::OverlayLayout(QObject *parent) :
+    QObject(parent),
+    m_referenceHeight{ 300 },
+    m_scale{ 1 },
+    m_fullRedraw{ true }
+{}
+
+OverlayLayout::~OverlayLayout()
+{}
+
+bool OverlayLayout::load(const QString &fileName)
+{
+    QFile file{ fileName };
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCritical() << "Failed to open overlay layout" << fileName;
+        return false;
+    }
+
+    QJsonParseError error;
+    auto document = QJsonDocument::fromJson(file.readAll(), &error);
+
+    if (error.error != QJsonParseError::NoError) {
+        qCritical() << "Failed to parse overlay layout" << fileName << error.errorString();
+        return false;
+    }
+
+    QJsonObject object = document.object();
+    QJsonArray items = object["items"].toArray();
+    QList<Item> parsed;
+
+    for (QJsonValueRef value : items) {
+        Item item;
+
+        if (!parseItem(value.toObject(), item)) {
+            qCritical() << "Invalid item in overlay layout" << fileName;
+            return false;
+        }
+
+        parsed.append(item);
+    }
+
+    m_referenceHeight = object["height"].toDouble(300);
+    m_items = parsed;
+    m_ops.clear();
+    m_fullRedraw = true;
+
+    if (!m_image.isNull())
+        compile(m_image.size());
+
+    return true;
+}
+
+void OverlayLayout::compile(const QSize &size)
+{
+    m_image = QImage{ size, QImage::Format_ARGB32_Premultiplied };
+    m_scale = double(size.height()) / m_referenceHeight;
+    m_ops.clear();
+
+    for (int i = 0; i < m_items.size(); ++i) {
+        const Item &item = m_items[i];
+        DrawOp op;
+        op.item = i;
+        op.rect = mapRect(item);
+
+        if (item.type == ItemType::Text) {
+            op.font = QFont{ item.fontFamily };
+            op.font.setPixelSize(qMax(1, qRound(item.fontSize * m_scale)));
+            op.font.setBold(item.bold);
+        } else if (item.type == ItemType::Svg) {
+            // Rasterize once, SvgRenderer is far too slow to run per render
+            QSvgRenderer renderer{ item.source };
+            op.raster = QImage{ op.rect.size(), QImage::Format_ARGB32_Premultiplied };
+            op.raster.fill(Qt::transparent);
+            QPainter painter{ &op.raster };
+            renderer.render(&painter);
+        }
+
+        m_ops.append(op);
+    }
+
+    m_fullRedraw = true;
+    render();
+}
+
+void OverlayLayout::setValue(const QString &binding, const QVariant &value)
+{
+    if (value.typeId() != QMetaType::QImage && m_values.value(binding) == value)
+        return;
+
+    m_values[binding] = value;
+
+    for (auto &op : m_ops) {
+        if (m_items[op.item].bindings.contains(binding))
+            op.dirty = true;
+    }
+}
+
+void OverlayLayout::setVisible(const QString &id, bool visible)
+{
+    for (auto &op : m_ops) {
+        if (m_items[op.item].id == id && op.visible != visible) {
+            op.visible = visible;
+            op.dirty = true;
+        }
+    }
+}
+
+QRegion OverlayLayout::render()
+{
+    if (m_image.isNull())
+        return {};
+
+    QPainter painter{ &m_image };
+    painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing | QPainter::SmoothPixmapTransform);
+
+    if (m_fullRedraw) {
+        m_image.fill(Qt::transparent);
+
+        for (auto &op : m_ops) {
+            draw(painter, op, m_values);
+            op.dirty = false;
+        }
+
+        m_fullRedraw = false;
+        return m_image.rect();
+    }
+
+    QRegion damage;
+
+    for (const auto &op : m_ops) {
+        if (op.dirty)
+            damage += op.rect;
+    }
+
+    if (damage.isEmpty())
+        return damage;
+
+    // Clear damaged area and replay every operation overlapping it,
+    // so static backgrounds under changed values stay intact
+    painter.setClipRegion(damage);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+    for (const QRect &rect : damage)
+        painter.fillRect(rect, Qt::transparent);
+
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+    for (auto &op : m_ops) {
+        if (damage.intersects(op.rect))
+            draw(painter, op, m_values);
+
+        op.dirty = false;
+    }
+
+    return damage;
+}
+
+QRect OverlayLayout::itemRect(const QString &id) const
+{
+    for (const auto &op : m_ops) {
+        if (m_items[op.item].id == id)
+            return op.rect;
+    }
+
+    return {};
+}
+
+// Render a single item into its own tile, optionally overriding bound values
+QImage OverlayLayout::renderItem(const QString &id, const QHash<QString, QVariant> &values) const
+{
+    for (const auto &op : m_ops) {
+        if (m_items[op.item].id != id)
+            continue;
+
+        QHash<QString, QVariant> merged = m_values;
+        merged.insert(values);
+
+        QImage tile{ op.rect.size(), QImage::Format_ARGB32_Premultiplied };
+        tile.fill(Qt::transparent);
+        QPainter painter{ &tile };
+        painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing | QPainter::SmoothPixmapTransform);
+        painter.translate(-op.rect.topLeft());
+        DrawOp visibleOp = op;
+        visibleOp.visible = true;
+        draw(painter, visibleOp, merged);
+        return tile;
+    }
+
+    return {};
+}
+
+bool OverlayLayout::parseItem(const QJsonObject &object, Item &item) const
+{
+    static const QRegularExpression placeholder{ "\\{(\\w+)\\}" };
+    const QString type = object["type"].toString();
+    QJsonArray rect = object["rect"].toArray();
+
+    if (rect.size() != 4)
+        return false;
+
+    item.id = object["id"].toString();
+    item.rect = QRectF{ rect[0].toDouble(), rect[1].toDouble(), rect[2].toDouble(), rect[3].toDouble() };
+    item.anchorRight = object["anchor"].toString() == "right";
+    item.color = QColor{ object["color"].toString("white") };
+
+    if (type == "rect") {
+        item.type = ItemType::Rect;
+    } else if (type == "text") {
+        item.type = ItemType::Text;
+        item.text = object["text"].toString();
+        item.alignment = parseAlignment(object["align"].toString());
+        QJsonObject font = object["font"].toObject();
+        item.fontFamily = font["family"].toString();
+        item.fontSize = font["size"].toDouble(12);
+        item.bold = font["bold"].toBool();
+
+        for (const auto &match : placeholder.globalMatch(item.text))
+            item.bindings.append(match.captured(1));
+    } else if (type == "image") {
+        item.type = ItemType::Image;
+        item.bindings.append(object["bind"].toString());
+    } else if (type == "svg") {
+        item.type = ItemType::Svg;
+        item.source = object["source"].toString();
+    } else if (type == "bar") {
+        item.type = ItemType::Bar;
+        item.background = QColor{ object["background"].toString("transparent") };
+        item.bindings.append(object["bind"].toString());
+        item.bindings.append(object["max"].toString());
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+QRect OverlayLayout::mapRect(const Item &item) const
+{
+    const qreal referenceWidth = m_image.width() / m_scale;
+    const qreal x = item.anchorRight ?
+        referenceWidth - item.rect.x() - item.rect.width() :
+        item.rect.x();
+
+    return QRectF{
+        x * m_scale,
+        item.rect.y() * m_scale,
+        item.rect.width() * m_scale,
+        item.rect.height() * m_scale
+    }.toAlignedRect();
+}
+
+void OverlayLayout::draw(QPainter &painter, const DrawOp &op, const QHash<QString, QVariant> &values) const
+{
+    const Item &item = m_items[op.item];
+
+    if (!op.visible)
+        return;
+
+    switch (item.type) {
+    case ItemType::Rect:
+        painter.fillRect(op.rect, item.color);
+        break;
+    case ItemType::Text: {
+        QString text = item.text;
+
+        for (const auto &binding : item.bindings)
+            text.replace(QString("{%1}").arg(binding), values.value(binding).toString());
+
+        painter.setFont(op.font);
+        painter.setPen(item.color);
+        painter.drawText(op.rect, item.alignment, text);
+        break;
+    }
+    case ItemType::Image: {
+        const QImage image = values.value(item.bindings.first()).value<QImage>();
+
+        if (!image.isNull())
+            painter.drawImage(op.rect, image);
+
+        break;
+    }
+    case ItemType::Svg:
+        painter.drawImage(op.rect.topLeft(), op.raster);
+        break;
+    case ItemType::Bar: {
+        const double value = values.value(item.bindings[0]).toDouble();
+        const double max = values.value(item.bindings[1]).toDouble();
+        const double ratio = max > 0 ? std::clamp(value / max, 0.0, 1.0) : 0.0;
+        QRect fill = op.rect;
+        fill.setWidth(qRound(op.rect.width() * ratio));
+        painter.fillRect(op.rect, item.background);
+        painter.fillRect(fill, item.color);
+        break;
+    }
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QObject>
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <QRegion>
+#include <QStringList>
+#include <QVariant>
+
+class QJsonObject;
+class QPainter;
+
+// Overlay described by a JSON layout instead of a widget tree.
+// The description is compiled once per target resolution into a flat list
+// of positioned draw operations; render() then only re-runs operations
+// whose bound values changed since the previous call and reports the
+// area it touched.
+class OverlayLayout : public QObject
+{
+    Q_OBJECT
+
+public:
+    OverlayLayout(QObject *parent = nullptr);
+    ~OverlayLayout();
+
+    bool load(const QString &fileName);
+    void compile(const QSize &size);
+    void setValue(const QString &binding, const QVariant &value);
+    void setVisible(const QString &id, bool visible);
+    QRegion render();
+
+    const QImage &image() const { return m_image; }
+    QRect itemRect(const QString &id) const;
+    QImage renderItem(const QString &id, const QHash<QString, QVariant> &values = {}) const;
+
+private:
+    enum class ItemType
+    {
+        Rect,
+        Text,
+        Image,
+        Svg,
+        Bar
+    };
+
+    // Item as written in the description, in reference units
+    struct Item
+    {
+        QString id;
+        ItemType type = ItemType::Rect;
+        QRectF rect;
+        bool anchorRight = false;
+        QColor color;
+        QColor background;
+        QString text;
+        QString source;
+        QString fontFamily;
+        qreal fontSize = 12;
+        bool bold = false;
+        Qt::Alignment alignment = Qt::AlignLeft | Qt::AlignVCenter;
+        QStringList bindings;
+    };
+
+    // Item compiled for the current target resolution
+    struct DrawOp
+    {
+        int item;
+        QRect rect;
+        QFont font;
+        QImage raster;
+        bool visible = true;
+        bool dirty = true;
+    };
+
+    bool parseItem(const QJsonObject &object, Item &item) const;
+    QRect mapRect(const Item &item) const;
+    void draw(QPainter &painter, const DrawOp &op, const QHash<QString, QVariant> &values) const;
+
+private:
+    qreal m_referenceHeight;
+    qreal m_scale;
+    QList<Item> m_items;
+    QList<DrawOp> m_ops;
+    QHash<QString, QVariant> m_values;
+    QImage m_image;
+    bool m_fullRedraw;
+
+};
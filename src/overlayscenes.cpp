@@ -0,0 +1,211 @@
+#include "overlayscenes.h"
+#include "overlaylayout.h"
+#include "overlayanimation.h"
+
+#include <QDebug>
+#include <QImage>
+
+namespace
+{
+    const int tileSize = 64;
+
+    bool isOccupied(const QImage &image, const QRect &rect)
+    {
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y)) + rect.left();
+
+            for (int x = 0; x < rect.width(); ++x) {
+                if (qAlpha(line[x]) != 0)
+                    return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+OverlayScenes::OverlayScenes(QObject *parent) :
+    QObject(parent),
+    m_current{ nullptr },
+    m_pending{ nullptr }
+{}
+
+OverlayScenes::~OverlayScenes()
+{
+    qDeleteAll(m_scenes);
+}
+
+QString OverlayScenes::currentName() const
+{
+    if (m_pending)
+        return m_pending->name;
+    else if (m_current)
+        return m_current->name;
+    else
+        return {};
+}
+
+QRect OverlayScenes::itemRect(const QString &id) const
+{
+    if (m_current) {
+        const QRect rect = m_current->layout->itemRect(id);
+
+        if (!rect.isEmpty())
+            return rect;
+    }
+
+    for (const Scene *scene : m_scenes) {
+        const QRect rect = scene->layout->itemRect(id);
+
+        if (!rect.isEmpty())
+            return rect;
+    }
+
+    return {};
+}
+
+bool OverlayScenes::load(const QString &name, const QString &fileName)
+{
+    Scene *scene = m_scenes.value(name);
+    const bool created = !scene;
+
+    if (created) {
+        auto *layout = new OverlayLayout(this);
+        scene = new Scene{ name, layout, new OverlayAnimation(layout, this), {}, {} };
+    }
+
+    if (!scene->layout->load(fileName)) {
+        if (created) {
+            delete scene->animation;
+            delete scene->layout;
+            delete scene;
+        }
+
+        return false;
+    }
+
+    m_scenes.insert(name, scene);
+
+    if (created) {
+        connect(scene->animation, &OverlayAnimation::finished, this, [this, scene]() {
+            updateOccupancy(scene, scene->layout->render());
+        });
+    }
+
+    if (m_size.isValid()) {
+        scene->animation->prepare();
+        updateOccupancy(scene, scene->layout->render());
+    }
+
+    return true;
+}
+
+bool OverlayScenes::select(const QString &name)
+{
+    Scene *scene = m_scenes.value(name);
+
+    if (!scene) {
+        qWarning() << "Unknown overlay scene" << name;
+        return false;
+    }
+
+    // Actual switch happens in acquire() so a frame never mixes two scenes
+    if (!m_current)
+        m_current = scene;
+    else
+        m_pending = scene != m_current ? scene : nullptr;
+
+    emit currentChanged(name);
+    return true;
+}
+
+void OverlayScenes::compile(const QSize &size)
+{
+    m_size = size;
+
+    for (Scene *scene : m_scenes) {
+        scene->layout->compile(size);
+        scene->animation->prepare();
+        scene->tiles.clear();
+        updateOccupancy(scene, scene->layout->render() + QRect{ QPoint{}, size });
+    }
+}
+
+void OverlayScenes::setValue(const QString &binding, const QVariant &value)
+{
+    for (Scene *scene : m_scenes)
+        scene->layout->setValue(binding, value);
+}
+
+void OverlayScenes::hitPointsChanged(const int from, const int to, const int max)
+{
+    for (Scene *scene : m_scenes)
+        scene->animation->hitPointsChanged(from, to, max);
+}
+
+// Render every scene, not only the visible one, so a switch never waits on it
+void OverlayScenes::render()
+{
+    for (Scene *scene : m_scenes)
+        updateOccupancy(scene, scene->layout->render());
+}
+
+// Called once per output frame, applies a pending scene switch
+const OverlayScenes::Scene *OverlayScenes::acquire()
+{
+    if (m_pending) {
+        m_current = m_pending;
+        m_pending = nullptr;
+    }
+
+    return m_current;
+}
+
+void OverlayScenes::advance()
+{
+    for (Scene *scene : m_scenes) {
+        if (scene->animation->advance())
+            updateOccupancy(scene, scene->layout->render());
+    }
+}
+
+void OverlayScenes::updateOccupancy(Scene *scene, const QRegion &damage)
+{
+    const QImage &image = scene->layout->image();
+    const QRect bounds = damage.boundingRect() & image.rect();
+    const int columns = (image.width() + tileSize - 1) / tileSize;
+    const int rows = (image.height() + tileSize - 1) / tileSize;
+
+    if (scene->tiles.size() != columns * rows)
+        scene->tiles = QBitArray(columns * rows);
+
+    if (bounds.isEmpty())
+        return;
+
+    for (int row = bounds.top() / tileSize; row <= bounds.bottom() / tileSize; ++row) {
+        for (int column = bounds.left() / tileSize; column <= bounds.right() / tileSize; ++column) {
+            const QRect tile = QRect{ column * tileSize, row * tileSize, tileSize, tileSize } & image.rect();
+
+            if (damage.intersects(tile))
+                scene->tiles.setBit(row * columns + column, isOccupied(image, tile));
+        }
+    }
+
+    scene->occupancy.clear();
+
+    for (int row = 0; row < rows; ++row) {
+        int start = -1;
+
+        for (int column = 0; column <= columns; ++column) {
+            const bool occupied = column < columns && scene->tiles.testBit(row * columns + column);
+
+            if (occupied && start < 0) {
+                start = column;
+            } else if (!occupied && start >= 0) {
+                const QRect span{ start * tileSize, row * tileSize, (column - start) * tileSize, tileSize };
+                scene->occupancy.append(span & image.rect());
+                start = -1;
+            }
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QObject>
+#include <QBitArray>
+#include <QList>
+#include <QMap>
+#include <QRect>
+#include <QVariant>
+
+class OverlayLayout;
+class OverlayAnimation;
+
+// Named overlay layouts kept compiled and rendered side by side, so that
+// switching between them is a pointer swap at the next frame boundary
+class OverlayScenes : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Scene
+    {
+        QString name;
+        OverlayLayout *layout;
+        OverlayAnimation *animation;
+        // Non-transparent tiles of the rendered layout, merged into row spans
+        QList<QRect> occupancy;
+        QBitArray tiles;
+    };
+
+    OverlayScenes(QObject *parent = nullptr);
+    ~OverlayScenes();
+
+    QStringList names() const { return m_scenes.keys(); }
+    QString currentName() const;
+    QRect itemRect(const QString &id) const;
+
+    bool load(const QString &name, const QString &fileName);
+    bool select(const QString &name);
+    void compile(const QSize &size);
+    void setValue(const QString &binding, const QVariant &value);
+    void hitPointsChanged(const int from, const int to, const int max);
+    void render();
+
+    const Scene *acquire();
+    void advance();
+
+signals:
+    void currentChanged(const QString &name);
+
+private:
+    void updateOccupancy(Scene *scene, const QRegion &damage);
+
+private:
+    QMap<QString, Scene *> m_scenes;
+    Scene *m_current;
+    Scene *m_pending;
+    QSize m_size;
+
+};
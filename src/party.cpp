@@ -0,0 +1,109 @@
+#include "party.h"
+#include "character.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+namespace
+{
+    const char *directoryName = "party";
+    const int maxInFlight = 3;
+}
+
+Party::Party(QNetworkAccessManager *manager, PortraitCache *portraitCache, QObject *parent) :
+    QObject(parent),
+    m_manager{ manager },
+    m_portraitCache{ portraitCache },
+    m_inFlight{ 0 }
+{}
+
+Party::~Party()
+{}
+
+void Party::setPortraitSize(const QSize &size)
+{
+    m_portraitSize = size;
+
+    for (Character *member : m_members)
+        member->setPortraitSize(size);
+}
+
+void Party::setMembers(const QList<int> &ids)
+{
+    if (ids == m_ids)
+        return;
+
+    QList<Character *> members;
+    QDir{}.mkpath(directoryName);
+
+    // Members staying in the party keep their state and tiles
+    for (const int id : ids) {
+        Character *character = member(id);
+
+        if (!character) {
+            const QString baseName = QString("%1/%2").arg(directoryName).arg(id);
+            character = new Character(m_manager, m_portraitCache, baseName, this);
+            character->setPortraitSize(m_portraitSize);
+            character->load();
+        }
+
+        members.append(character);
+    }
+
+    for (Character *character : m_members) {
+        if (!members.contains(character))
+            character->deleteLater();
+    }
+
+    m_members = members;
+    m_ids = ids;
+    emit membersChanged();
+    reload();
+}
+
+void Party::reload()
+{
+    for (const int id : m_ids) {
+        if (!m_queue.contains(id))
+            m_queue.append(id);
+    }
+
+    fetchNext();
+}
+
+Character *Party::member(const int id) const
+{
+    const int index = m_ids.indexOf(id);
+    return index >= 0 ? m_members[index] : nullptr;
+}
+
+void Party::fetchNext()
+{
+    while (m_inFlight < maxInFlight && !m_queue.isEmpty()) {
+        const int id = m_queue.takeFirst();
+        Character *character = member(id);
+
+        if (!character)
+            continue;
+
+        QNetworkReply *reply = m_manager->get(QNetworkRequest{ character->serviceUrl(id) });
+        ++m_inFlight;
+
+        connect(reply, &QNetworkReply::finished, this, [this, reply, id]() {
+            reply->deleteLater();
+            --m_inFlight;
+
+            // Member may have left the party while the request was running
+            Character *character = member(id);
+
+            if (reply->error() != QNetworkReply::NoError)
+                qWarning() << "Failed to fetch party member" << id << reply->errorString();
+            else if (character)
+                character->apply(reply->readAll());
+
+            fetchNext();
+        });
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QSize>
+
+class QNetworkAccessManager;
+class Character;
+class PortraitCache;
+
+// Characters shown together in the party strip. Members share one network
+// manager and portrait cache; their payloads are fetched concurrently but
+// never more than a few at a time.
+class Party : public QObject
+{
+    Q_OBJECT
+
+public:
+    Party(QNetworkAccessManager *manager, PortraitCache *portraitCache, QObject *parent = nullptr);
+    ~Party();
+
+    const QList<Character *> &members() const { return m_members; }
+    QList<int> ids() const { return m_ids; }
+    void setPortraitSize(const QSize &size);
+
+public slots:
+    void setMembers(const QList<int> &ids);
+    void reload();
+
+signals:
+    void membersChanged();
+
+private:
+    Character *member(const int id) const;
+    void fetchNext();
+
+private:
+    QNetworkAccessManager *m_manager;
+    PortraitCache *m_portraitCache;
+    QList<Character *> m_members;
+    QList<int> m_ids;
+    QList<int> m_queue;
+    int m_inFlight;
+    QSize m_portraitSize;
+
+};
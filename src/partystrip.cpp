@@ -0,0 +1,166 @@
+#include "partystrip.h"
+#include "character.h"
+#include "overlaylayout.h"
+#include "party.h"
+
+#include <algorithm>
+
+#include <QPainter>
+
+namespace
+{
+    // Tile geometry in the same 300 unit reference height scenes use
+    const qreal referenceHeight = 300;
+    const QSizeF tileSize{ 120, 36 };
+    const qreal spacing = 4;
+    const qreal margin = 8;
+}
+
+PartyStrip::PartyStrip(Party *party, QObject *parent) :
+    QObject(parent),
+    m_party{ party },
+    m_template{ new OverlayLayout(this) }
+{
+    connect(m_party, &Party::membersChanged, this, &PartyStrip::rebuild);
+}
+
+PartyStrip::~PartyStrip()
+{}
+
+bool PartyStrip::load(const QString &fileName)
+{
+    if (!m_template->load(fileName))
+        return false;
+
+    m_fileName = fileName;
+
+    for (Tile &tile : m_tiles) {
+        tile.layout->load(fileName);
+        updateIdentity(tile);
+        updateStats(tile, CharacterStats::allNodes);
+        updatePortrait(tile);
+    }
+
+    return true;
+}
+
+void PartyStrip::compile(const QSize &size)
+{
+    const qreal scale = size.height() / referenceHeight;
+    m_size = size;
+    m_tileSize = (tileSize * scale).toSize();
+    m_template->compile(m_tileSize);
+    m_party->setPortraitSize(m_template->itemRect("portrait").size());
+
+    for (const Tile &tile : m_tiles)
+        tile.layout->compile(m_tileSize);
+
+    arrange();
+}
+
+void PartyStrip::draw(QPainter &painter) const
+{
+    for (const Tile &tile : m_tiles)
+        painter.drawImage(tile.position, tile.layout->image());
+}
+
+void PartyStrip::rebuild()
+{
+    QList<Tile> tiles;
+
+    for (Character *member : m_party->members()) {
+        auto existing = std::find_if(m_tiles.begin(), m_tiles.end(), [member](const Tile &tile) {
+            return tile.member == member;
+        });
+
+        if (existing != m_tiles.end()) {
+            tiles.append(*existing);
+            m_tiles.erase(existing);
+            continue;
+        }
+
+        Tile tile{ member, new OverlayLayout(this), {} };
+        tile.layout->load(m_fileName);
+
+        if (m_tileSize.isValid())
+            tile.layout->compile(m_tileSize);
+
+        // Layout is the connection context, leaving members take theirs along
+        connect(member, &Character::updated, tile.layout, [this, tile]() {
+            updateIdentity(tile);
+        });
+        connect(member, &Character::statsChanged, tile.layout, [this, tile](CharacterStats::ChangeSet changes) {
+            updateStats(tile, changes);
+        });
+        connect(member, &Character::portraitUpdated, tile.layout, [this, tile]() {
+            updatePortrait(tile);
+        });
+
+        updateIdentity(tile);
+        updateStats(tile, CharacterStats::allNodes);
+        updatePortrait(tile);
+        tiles.append(tile);
+    }
+
+    for (const Tile &tile : m_tiles)
+        delete tile.layout;
+
+    m_tiles = tiles;
+    arrange();
+}
+
+// Rows of tiles growing upwards from the bottom left corner
+void PartyStrip::arrange()
+{
+    if (!m_size.isValid())
+        return;
+
+    const qreal scale = m_size.height() / referenceHeight;
+    const int step = m_tileSize.width() + qRound(spacing * scale);
+    const int x = qRound(margin * scale);
+    const int columns = qMax(1, (m_size.width() - 2 * x + qRound(spacing * scale)) / step);
+    const int bottom = m_size.height() - qRound(margin * scale) - m_tileSize.height();
+
+    for (int i = 0; i < m_tiles.size(); ++i) {
+        const int row = i / columns;
+        const int column = i % columns;
+        m_tiles[i].position = QPoint{
+            x + column * step,
+            bottom - row * (m_tileSize.height() + qRound(spacing * scale))
+        };
+    }
+}
+
+void PartyStrip::updateIdentity(const Tile &tile)
+{
+    tile.layout->setValue("name", tile.member->name());
+    tile.layout->setValue("race", tile.member->race());
+    tile.layout->setValue("class", tile.member->playerClass());
+    tile.layout->render();
+}
+
+void PartyStrip::updateStats(const Tile &tile, CharacterStats::ChangeSet changes)
+{
+    if (changes & CharacterStats::bit(CharacterStats::Level))
+        tile.layout->setValue("level", tile.member->level());
+
+    if (changes & CharacterStats::bit(CharacterStats::ArmorClass))
+        tile.layout->setValue("armorClass", tile.member->armorClass());
+
+    if (changes & CharacterStats::bit(CharacterStats::MaxHitPoints))
+        tile.layout->setValue("maxHitPoints", tile.member->maxHitPoints());
+
+    if (changes & CharacterStats::bit(CharacterStats::CurrentHitPoints))
+        tile.layout->setValue("hitPoints", tile.member->currenthitPoints());
+
+    tile.layout->render();
+}
+
+void PartyStrip::updatePortrait(const Tile &tile)
+{
+    if (tile.member->portrait().isNull())
+        return;
+
+    tile.layout->setValue("portrait", tile.member->portrait());
+    tile.layout->render();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QPoint>
+#include <QSize>
+
+#include "characterstats.h"
+
+class QPainter;
+class Character;
+class OverlayLayout;
+class Party;
+
+// Compact overlay with one tile per party member. Every tile is a small
+// layout of its own, re-rendered only when its member changes, so drawing
+// the strip is a blit of ready tiles.
+class PartyStrip : public QObject
+{
+    Q_OBJECT
+
+public:
+    PartyStrip(Party *party, QObject *parent = nullptr);
+    ~PartyStrip();
+
+    bool load(const QString &fileName);
+    void compile(const QSize &size);
+    void draw(QPainter &painter) const;
+
+private:
+    struct Tile
+    {
+        Character *member;
+        OverlayLayout *layout;
+        QPoint position;
+    };
+
+    void rebuild();
+    void arrange();
+    void updateIdentity(const Tile &tile);
+    void updateStats(const Tile &tile, CharacterStats::ChangeSet changes);
+    void updatePortrait(const Tile &tile);
+
+private:
+    Party *m_party;
+    OverlayLayout *m_template;
+    QString m_fileName;
+    QList<Tile> m_tiles;
+    QSize m_size;
+    QSize m_tileSize;
+
+};
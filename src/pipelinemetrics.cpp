@@ -0,0 +1,95 @@
+#include "pipelinemetrics.h"
+
+#include <QDebug>
+#include <QLoggingCategory>
+#include <QStringList>
+#include <QTimer>
+
+// Summary is shown in the status bar, logging it too is opt-in
+Q_LOGGING_CATEGORY(pipelineLog, "dungeoncamera.pipeline", QtInfoMsg)
+
+namespace
+{
+    const int reportInterval = 5000;
+
+    QString milliseconds(const qint64 nanoseconds)
+    {
+        return QString::number(nanoseconds / 1e6, 'f', 2);
+    }
+}
+
+PipelineMetrics::PipelineMetrics(QObject *parent) :
+    QObject(parent),
+    m_timer{ new QTimer(this) }
+{
+    connect(m_timer, &QTimer::timeout, this, &PipelineMetrics::report);
+    m_timer->start(reportInterval);
+    m_interval.start();
+}
+
+PipelineMetrics::~PipelineMetrics()
+{}
+
+void PipelineMetrics::record(const QString &stage, const qint64 nanoseconds)
+{
+    QMutexLocker locker{ &m_mutex };
+    Timing &timing = m_timings[stage];
+    ++timing.samples;
+    timing.total += nanoseconds;
+    timing.max = qMax(timing.max, nanoseconds);
+}
+
+void PipelineMetrics::count(const QString &counter, const qint64 value)
+{
+    QMutexLocker locker{ &m_mutex };
+    m_counters[counter] += value;
+}
+
+void PipelineMetrics::transfer(const QString &stage, const qint64 bytes)
+{
+    QMutexLocker locker{ &m_mutex };
+    m_transfers[stage] += bytes;
+}
+
+// Averages over the last interval, e.g. "decode 7.91 ms (max 12.40)"
+void PipelineMetrics::report()
+{
+    QStringList parts;
+
+    {
+        QMutexLocker locker{ &m_mutex };
+
+        for (auto it = m_timings.cbegin(); it != m_timings.cend(); ++it) {
+            if (it->samples == 0)
+                continue;
+
+            parts.append(QString("%1 %2 ms (max %3)")
+                .arg(it.key())
+                .arg(milliseconds(it->total / it->samples))
+                .arg(milliseconds(it->max)));
+        }
+
+        for (auto it = m_counters.cbegin(); it != m_counters.cend(); ++it) {
+            if (it.value() != 0)
+                parts.append(QString("%1 %2").arg(it.key()).arg(it.value()));
+        }
+
+        const double seconds = qMax<qint64>(1, m_interval.restart()) / 1000.0;
+
+        for (auto it = m_transfers.cbegin(); it != m_transfers.cend(); ++it) {
+            if (it.value() != 0)
+                parts.append(QString("%1 %2 MB/s").arg(it.key()).arg(it.value() / seconds / 1e6, 0, 'f', 1));
+        }
+
+        m_timings.clear();
+        m_counters.clear();
+        m_transfers.clear();
+    }
+
+    if (parts.isEmpty())
+        return;
+
+    const QString summary = parts.join("  ");
+    qCDebug(pipelineLog).noquote() << "Pipeline:" << summary;
+    emit summaryChanged(summary);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMutex>
+
+class QTimer;
+
+// Timings and counters of the video pipeline, summarized every few
+// seconds. Safe to feed from worker threads.
+class PipelineMetrics : public QObject
+{
+    Q_OBJECT
+
+public:
+    PipelineMetrics(QObject *parent = nullptr);
+    ~PipelineMetrics();
+
+    void record(const QString &stage, const qint64 nanoseconds);
+    void count(const QString &counter, const qint64 value = 1);
+    // Reported as throughput over the interval
+    void transfer(const QString &stage, const qint64 bytes);
+
+signals:
+    void summaryChanged(const QString &summary);
+
+private:
+    struct Timing
+    {
+        qint64 samples = 0;
+        qint64 total = 0;
+        qint64 max = 0;
+    };
+
+    void report();
+
+private:
+    QTimer *m_timer;
+    QMutex m_mutex;
+    QMap<QString, Timing> m_timings;
+    QMap<QString, qint64> m_counters;
+    QMap<QString, qint64> m_transfers;
+    QElapsedTimer m_interval;
+
+};
@@ -0,0 +1,191 @@
+#include "pipesink.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QThread>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+
+#include <algorithm>
+#else
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const int retryInterval = 100;
+#ifdef Q_OS_WIN
+    // About three NV12 frames at 1080p
+    const DWORD pipeBufferSize = 8 * 1024 * 1024;
+#endif
+}
+
+PipeSink::PipeSink(PipelineMetrics *metrics, const QString &path, QObject *parent) :
+    WriteBehindSink(metrics, "pipe", parent),
+    m_path{ path },
+#ifdef Q_OS_WIN
+    m_handle{ INVALID_HANDLE_VALUE }
+#else
+    m_fd{ -1 }
+#endif
+{
+    // About 10 NV12 frames at 1080p
+    setMemoryLimit(32 * 1024 * 1024);
+}
+
+PipeSink::~PipeSink()
+{
+    stop();
+}
+
+#ifdef Q_OS_WIN
+
+bool PipeSink::openOutput()
+{
+    const std::wstring path = m_path.toStdWString();
+
+    if (m_path == "-") {
+        // Nothing else writes to stdout of a GUI process, so it can be made non-blocking too
+        if (!DuplicateHandle(GetCurrentProcess(), GetStdHandle(STD_OUTPUT_HANDLE), GetCurrentProcess(), &m_handle, 0, FALSE, DUPLICATE_SAME_ACCESS))
+            m_handle = INVALID_HANDLE_VALUE;
+
+        DWORD mode = PIPE_NOWAIT;
+
+        if (m_handle != INVALID_HANDLE_VALUE && GetFileType(m_handle) == FILE_TYPE_PIPE)
+            SetNamedPipeHandleState(m_handle, &mode, nullptr, nullptr);
+    } else if (m_path.startsWith("\\\\.\\pipe\\", Qt::CaseInsensitive)) {
+        // Non-blocking pipe, connecting and writing return right away like the FIFO on Unix
+        m_handle = CreateNamedPipeW(path.c_str(), PIPE_ACCESS_OUTBOUND | FILE_FLAG_FIRST_PIPE_INSTANCE,
+            PIPE_TYPE_BYTE | PIPE_NOWAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, pipeBufferSize, 0, 0, nullptr);
+
+        while (m_handle != INVALID_HANDLE_VALUE && !ConnectNamedPipe(m_handle, nullptr)
+            && GetLastError() != ERROR_PIPE_CONNECTED) {
+            if (GetLastError() != ERROR_PIPE_LISTENING || isStopping()) {
+                CloseHandle(m_handle);
+                m_handle = INVALID_HANDLE_VALUE;
+                break;
+            }
+
+            QThread::msleep(retryInterval);
+        }
+    } else {
+        m_handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+
+    if (m_handle == INVALID_HANDLE_VALUE) {
+        if (!isStopping())
+            qCritical() << "Failed to open pipe output" << m_path << qt_error_string();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool PipeSink::writeOutput(const char *data, const qint64 size)
+{
+    qint64 remaining = size;
+
+    while (remaining > 0) {
+        DWORD written = 0;
+
+        if (!WriteFile(m_handle, data, DWORD(std::min<qint64>(remaining, pipeBufferSize)), &written, nullptr)) {
+            qWarning() << "Pipe output stopped" << qt_error_string();
+            return false;
+        }
+
+        data += written;
+        remaining -= written;
+
+        // Full non-blocking pipe takes nothing
+        if (written == 0) {
+            if (isStopping())
+                return false;
+
+            QThread::msleep(retryInterval);
+        }
+    }
+
+    return true;
+}
+
+void PipeSink::closeOutput()
+{
+    if (m_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+    }
+}
+
+#else
+
+bool PipeSink::openOutput()
+{
+    // A reader going away must fail the write, not kill the process
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (m_path == "-") {
+        // Own file description, so stdout of everyone else stays blocking
+        m_fd = ::open("/proc/self/fd/1", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+
+        if (m_fd < 0)
+            m_fd = ::dup(STDOUT_FILENO);
+    } else {
+        const QByteArray path = QFile::encodeName(m_path);
+
+        // FIFO refuses non-blocking writers until a reader shows up
+        while ((m_fd = ::open(path.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK | O_CLOEXEC, 0644)) < 0
+            && errno == ENXIO && !isStopping())
+            QThread::msleep(retryInterval);
+    }
+
+    if (m_fd < 0) {
+        if (!isStopping())
+            qCritical() << "Failed to open pipe output" << m_path << std::strerror(errno);
+
+        return false;
+    }
+
+    return true;
+}
+
+bool PipeSink::writeOutput(const char *data, const qint64 size)
+{
+    qint64 remaining = size;
+
+    while (remaining > 0) {
+        const ssize_t written = ::write(m_fd, data, remaining);
+
+        if (written >= 0) {
+            data += written;
+            remaining -= written;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (isStopping())
+                return false;
+
+            pollfd descriptor{ m_fd, POLLOUT, 0 };
+            ::poll(&descriptor, 1, retryInterval);
+        } else if (errno != EINTR) {
+            qWarning() << "Pipe output stopped" << std::strerror(errno);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PipeSink::closeOutput()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+#endif
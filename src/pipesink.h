@@ -0,0 +1,32 @@
+#pragma once
+
+#include "writebehindsink.h"
+
+// Streams the output into a file, FIFO or stdout ("-") for external
+// encoders, e.g. `mkfifo /tmp/camera.y4m && ffmpeg -i /tmp/camera.y4m ...`.
+// On Windows a `\\.\pipe\` path creates that named pipe for the encoder
+// to open, e.g. `ffmpeg -i \\.\pipe\camera ...`.
+// The pipe is non-blocking, so a stalled reader only costs dropped
+// frames and never keeps stop() waiting.
+class PipeSink : public WriteBehindSink
+{
+    Q_OBJECT
+
+public:
+    PipeSink(PipelineMetrics *metrics, const QString &path, QObject *parent = nullptr);
+    ~PipeSink();
+
+protected:
+    bool openOutput() override;
+    bool writeOutput(const char *data, const qint64 size) override;
+    void closeOutput() override;
+
+private:
+    QString m_path;
+#ifdef Q_OS_WIN
+    void *m_handle;
+#else
+    int m_fd;
+#endif
+
+};
@@ -0,0 +1,145 @@
+#include "portraitcache.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QImageReader>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace
+{
+    // Lets the JPEG decoder downscale while decoding instead of afterwards
+    QImage decodeScaled(QIODevice *device, const QSize &size)
+    {
+        QImageReader reader{ device };
+
+        if (size.isValid())
+            reader.setScaledSize(size);
+
+        return reader.read().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    // Replaces the file only once everything was written
+    bool saveFile(const QString &fileName, const QByteArray &bytes)
+    {
+        QSaveFile file{ fileName };
+
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+
+        file.write(bytes);
+        return file.commit();
+    }
+}
+
+PortraitCache::PortraitCache(QNetworkAccessManager *manager, QObject *parent) :
+    QObject(parent),
+    m_manager{ manager },
+    m_directory{ QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/portraits" },
+    m_sequence{ 0 }
+{
+    QDir{}.mkpath(m_directory);
+}
+
+PortraitCache::~PortraitCache()
+{}
+
+void PortraitCache::request(const QUrl &url, const QSize &size)
+{
+    if (url.isEmpty())
+        return;
+
+    const QString fileName = cachePath(url);
+    QNetworkRequest request{ url };
+
+    // Hand out the cached copy right away, the network only confirms it
+    if (QFile::exists(fileName)) {
+        QFile validator{ fileName + ".meta" };
+
+        if (validator.open(QIODevice::ReadOnly)) {
+            const QByteArray etag = validator.readLine().trimmed();
+            const QByteArray lastModified = validator.readLine().trimmed();
+
+            if (!etag.isEmpty())
+                request.setRawHeader("If-None-Match", etag);
+
+            if (!lastModified.isEmpty())
+                request.setRawHeader("If-Modified-Since", lastModified);
+        }
+
+        decode({ url, size }, [fileName, size]() {
+            QFile file{ fileName };
+
+            if (!file.open(QIODevice::ReadOnly))
+                return QImage{};
+
+            return decodeScaled(&file, size);
+        });
+    }
+
+    QNetworkReply *reply = m_manager->get(request);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, url, fileName, size]() {
+        reply->deleteLater();
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+        if (reply->error() != QNetworkReply::NoError || status == 304)
+            return;
+
+        const QByteArray bytes = reply->readAll();
+        const QByteArray etag = reply->rawHeader("ETag");
+        const QByteArray lastModified = reply->rawHeader("Last-Modified");
+
+        decode({ url, size }, [bytes, etag, lastModified, fileName, size]() {
+            // Validators go last, so they never describe a body that is not on disk
+            if (!saveFile(fileName, bytes)) {
+                qWarning() << "Failed to cache portrait" << fileName;
+            } else if (!saveFile(fileName + ".meta", etag + '\n' + lastModified + '\n')) {
+                QFile::remove(fileName + ".meta");
+                qWarning() << "Failed to cache portrait validators" << fileName;
+            }
+
+            QBuffer buffer;
+            buffer.setData(bytes);
+            buffer.open(QIODevice::ReadOnly);
+            return decodeScaled(&buffer, size);
+        });
+    });
+}
+
+QString PortraitCache::cachePath(const QUrl &url) const
+{
+    const QByteArray key = QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex();
+    return m_directory + '/' + QString::fromLatin1(key);
+}
+
+void PortraitCache::decode(const Key &key, std::function<QImage()> job)
+{
+    auto *watcher = new QFutureWatcher<QImage>(this);
+    const quint64 sequence = ++m_sequence;
+
+    connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, key, sequence]() {
+        const QImage image = watcher->result();
+        watcher->deleteLater();
+
+        // A fresh download may finish decoding before the cached copy
+        if (sequence < m_delivered.value(key))
+            return;
+
+        if (!image.isNull()) {
+            m_delivered.insert(key, sequence);
+            emit ready(key.url, key.size, image);
+        } else {
+            qWarning() << "Failed to decode portrait" << key.url;
+        }
+    });
+
+    watcher->setFuture(QtConcurrent::run(std::move(job)));
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QSize>
+#include <QUrl>
+
+#include <functional>
+
+class QNetworkAccessManager;
+
+// Portraits kept on disk next to their HTTP validators. Downloads are
+// conditional, decoding happens on a worker thread directly at the size the
+// overlay draws them, so only the final image reaches the GUI thread.
+class PortraitCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    PortraitCache(QNetworkAccessManager *manager, QObject *parent = nullptr);
+    ~PortraitCache();
+
+    void request(const QUrl &url, const QSize &size);
+
+signals:
+    // Size is the one requested, several can be in flight for the same url
+    void ready(const QUrl &url, const QSize &size, const QImage &image);
+
+private:
+    struct Key
+    {
+        QUrl url;
+        QSize size;
+
+        bool operator==(const Key &other) const { return url == other.url && size == other.size; }
+        friend size_t qHash(const Key &key, size_t seed = 0) { return qHashMulti(seed, key.url, key.size.width(), key.size.height()); }
+    };
+
+    QString cachePath(const QUrl &url) const;
+    void decode(const Key &key, std::function<QImage()> job);
+
+private:
+    QNetworkAccessManager *m_manager;
+    QString m_directory;
+    quint64 m_sequence;
+    QHash<Key, quint64> m_delivered;
+
+};
@@ -0,0 +1,56 @@
+#include "previewoutput.h"
+
+#include <QVideoFrame>
+#include <QVideoFrameFormat>
+#include <QVideoSink>
+#include <libyuv.h>
+
+namespace
+{
+    const double defaultRate = 15;
+}
+
+PreviewOutput::PreviewOutput(QVideoSink *sink, QObject *parent) :
+    QObject(parent),
+    m_sink{ sink },
+    m_maxRate{ defaultRate }
+{}
+
+PreviewOutput::~PreviewOutput()
+{}
+
+void PreviewOutput::setMaxRate(const double fps)
+{
+    m_maxRate = fps;
+}
+
+bool PreviewOutput::send(const FrameView &frame, const QSize &target)
+{
+    if (m_clock.isValid() && m_clock.elapsed() < qint64(1000 / m_maxRate))
+        return false;
+
+    // Never upscale, the widget does that for free
+    QSize size{ frame.width, frame.height };
+
+    if (size.width() > target.width() || size.height() > target.height())
+        size.scale(target, Qt::KeepAspectRatio);
+
+    if (size.isEmpty())
+        return false;
+
+    m_clock.start();
+
+    QVideoFrame preview{ QVideoFrameFormat{ size, QVideoFrameFormat::Format_BGRX8888 } };
+
+    if (!preview.map(QVideoFrame::WriteOnly))
+        return false;
+
+    libyuv::ARGBScale(
+        frame.data[0], frame.stride[0], frame.width, frame.height,
+        preview.bits(0), preview.bytesPerLine(0), size.width(), size.height(),
+        libyuv::kFilterBox);
+    preview.unmap();
+
+    m_sink->setVideoFrame(preview);
+    return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "framebuffer.h"
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QSize>
+
+class QVideoSink;
+
+// Preview branch of the pipeline: the composited frame is downscaled
+// straight into a frame of the widget's size, at most a few times per
+// second. The preview does not need the camera rate or resolution.
+class PreviewOutput : public QObject
+{
+    Q_OBJECT
+
+public:
+    PreviewOutput(QVideoSink *sink, QObject *parent = nullptr);
+    ~PreviewOutput();
+
+    double maxRate() const { return m_maxRate; }
+    void setMaxRate(const double fps);
+
+    // Target is in device pixels, the frame keeps its aspect ratio inside it
+    bool send(const FrameView &frame, const QSize &target);
+
+private:
+    QVideoSink *m_sink;
+    QElapsedTimer m_clock;
+    double m_maxRate;
+
+};
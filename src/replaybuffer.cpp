@@ -0,0 +1,171 @@
+#include "replaybuffer.h"
+#include "virtualoutput.h"
+
+#include <QDebug>
+#include <QTimer>
+#include <libyuv.h>
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+namespace
+{
+    const int maxSeconds = 30;
+    // About 11 s at 1080p30 NV12, the rest is traded for a bounded footprint
+    const std::size_t defaultBudget = std::size_t(1024) * 1024 * 1024;
+    // Longer gaps are a stalled camera, not pacing worth reproducing
+    const std::uint64_t maxInterval = 1000000000;
+}
+
+ReplayBuffer::ReplayBuffer(VirtualOutput *output, QObject *parent) :
+    QObject(parent),
+    m_output{ output },
+    m_timer{ new QTimer(this) },
+    m_budget{ defaultBudget },
+    m_origin{ 0 },
+    m_head{ 0 },
+    m_count{ 0 },
+    m_position{ -1 },
+    m_remaining{ 0 }
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &ReplayBuffer::publishNext);
+}
+
+ReplayBuffer::~ReplayBuffer()
+{}
+
+void ReplayBuffer::setMemoryBudget(const std::size_t bytes)
+{
+    m_budget = bytes;
+}
+
+bool ReplayBuffer::start(const PixelLayout layout, const std::int32_t width, const std::int32_t height, const double fps, const ColorMatrix matrix, const ColorRange range)
+{
+    Q_UNUSED(matrix);
+    Q_UNUSED(range);
+    cancel();
+
+    // No point in keeping more than the longest replay
+    const double rate = qMax(fps, 1.0);
+    const std::size_t frameSize = packed_size(layout, width, height);
+    const std::size_t wanted = std::size_t(std::ceil(maxSeconds * rate));
+    const std::size_t capacity = std::min(wanted, m_budget / frameSize);
+
+    if (capacity < 2) {
+        qWarning() << "Replay budget is too small for" << width << "x" << height << "frames";
+        return false;
+    }
+
+    if (capacity < wanted) {
+        qWarning() << "Replay budget of" << m_budget / (1024 * 1024) << "MB holds" << capacity / rate
+                   << "of" << maxSeconds << "seconds at" << width << "x" << height << "with" << fps << "fps";
+    }
+
+    try {
+        m_frames.resize(capacity);
+        m_timestamps.assign(capacity, 0);
+
+        for (AlignedFrameBuffer &frame : m_frames)
+            frame.allocate(layout, width, height);
+    } catch (const std::bad_alloc &) {
+        qCritical() << "Failed to allocate" << capacity << "replay frames of" << width << "x" << height;
+        stop();
+        return false;
+    }
+
+    m_head = 0;
+    m_count = 0;
+    return true;
+}
+
+void ReplayBuffer::stop()
+{
+    cancel();
+    m_frames.clear();
+    m_frames.shrink_to_fit();
+    m_timestamps.clear();
+    m_head = 0;
+    m_count = 0;
+}
+
+void ReplayBuffer::write(const FrameView &frame, const std::uint64_t timestamp)
+{
+    if (isReplaying() || m_frames.empty())
+        return;
+
+    AlignedFrameBuffer &target = m_frames[m_head];
+    const PixelLayout layout = target.layout();
+    const FrameView &view = target.view();
+
+    for (int i = 0; i < plane_count(layout); ++i) {
+        const std::int32_t row_bytes = plane_row_bytes(layout, i, view.width);
+        libyuv::CopyPlane(frame.data[i], frame.stride[i], view.data[i], view.stride[i], row_bytes, plane_rows(layout, i, view.height));
+    }
+
+    m_timestamps[m_head] = timestamp;
+    m_head = slot(1);
+    m_count = std::min(m_count + 1, int(m_frames.size()));
+}
+
+void ReplayBuffer::replay(const int seconds)
+{
+    if (isReplaying() || m_count == 0)
+        return;
+
+    const std::uint64_t newest = m_timestamps[slot(-1)];
+    const std::uint64_t span = std::uint64_t(std::min(seconds, maxSeconds)) * 1000000000;
+    int frames = 1;
+
+    while (frames < m_count && newest - m_timestamps[slot(-frames - 1)] <= span)
+        ++frames;
+
+    m_position = slot(-frames);
+    m_remaining = frames;
+    m_origin = m_timestamps[m_position];
+    m_clock.start();
+    m_output->setLive(false);
+    publishNext();
+}
+
+void ReplayBuffer::cancel()
+{
+    if (!isReplaying())
+        return;
+
+    m_timer->stop();
+    m_position = -1;
+    m_remaining = 0;
+    m_output->setLive(true);
+    emit replayFinished();
+}
+
+void ReplayBuffer::publishNext()
+{
+    m_output->publish(m_frames[m_position].view());
+
+    if (--m_remaining == 0) {
+        cancel();
+        return;
+    }
+
+    const int next = (m_position + 1) % int(m_frames.size());
+    const std::uint64_t gap = m_timestamps[next] - m_timestamps[m_position];
+
+    if (gap > maxInterval)
+        m_origin += gap - maxInterval;
+
+    // Scheduled against the replay start, rounding does not add up
+    const qint64 due = qint64((m_timestamps[next] - m_origin) / 1000000);
+    m_position = next;
+    m_timer->start(int(qMax<qint64>(0, due - m_clock.elapsed())));
+}
+
+// Ring slot relative to the next one to be written
+int ReplayBuffer::slot(const int offset) const
+{
+    const int size = int(m_frames.size());
+    return ((m_head + offset) % size + size) % size;
+}
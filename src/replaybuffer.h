@@ -0,0 +1,60 @@
+#pragma once
+
+#include "framesink.h"
+
+#include <QObject>
+#include <QElapsedTimer>
+
+#include <vector>
+
+class QTimer;
+class VirtualOutput;
+
+// Keeps the last seconds of output frames to replay them to the virtual
+// camera on demand. The ring is allocated once in start() from the frame
+// size and the memory budget, recording and playback only copy into and
+// out of it. Recording pauses while a replay runs.
+class ReplayBuffer : public QObject, public FrameSink
+{
+    Q_OBJECT
+
+public:
+    ReplayBuffer(VirtualOutput *output, QObject *parent = nullptr);
+    ~ReplayBuffer();
+
+    bool isReplaying() const { return m_position >= 0; }
+    std::size_t memoryBudget() const { return m_budget; }
+    // Takes effect on the next start, a replay shorter than 30 s is
+    // announced when the budget can not hold that much
+    void setMemoryBudget(const std::size_t bytes);
+
+    bool start(const PixelLayout layout, const std::int32_t width, const std::int32_t height, const double fps, const ColorMatrix matrix, const ColorRange range) override;
+    void stop() override;
+    void write(const FrameView &frame, const std::uint64_t timestamp) override;
+
+public slots:
+    // Publishes the last seconds at their original pacing, then goes live again
+    void replay(const int seconds);
+    void cancel();
+
+signals:
+    void replayFinished();
+
+private:
+    void publishNext();
+    int slot(const int offset) const;
+
+private:
+    VirtualOutput *m_output;
+    QTimer *m_timer;
+    std::size_t m_budget;
+    std::vector<AlignedFrameBuffer> m_frames;
+    std::vector<std::uint64_t> m_timestamps;
+    QElapsedTimer m_clock;
+    std::uint64_t m_origin;
+    int m_head;
+    int m_count;
+    int m_position;
+    int m_remaining;
+
+};
@@ -0,0 +1,75 @@
+#include "sessionrecorder.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+
+namespace
+{
+    const qint64 maxSegmentSize = qint64(2) * 1024 * 1024 * 1024;
+}
+
+SessionRecorder::SessionRecorder(PipelineMetrics *metrics, const QString &directory, QObject *parent) :
+    WriteBehindSink(metrics, "record", parent),
+    m_directory{ directory },
+    m_segment{ 0 },
+    m_segmentSize{ 0 }
+{
+    // Hard cap on queued frames, about 40 NV12 frames at 1080p
+    setMemoryLimit(128 * 1024 * 1024);
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    stop();
+}
+
+bool SessionRecorder::openOutput()
+{
+    if (!QDir{}.mkpath(m_directory)) {
+        qCritical() << "Failed to create recording directory" << m_directory;
+        return false;
+    }
+
+    m_baseName = QDateTime::currentDateTime().toString("'session'-yyyyMMdd-hhmmss");
+    m_segment = 0;
+    return openSegment();
+}
+
+bool SessionRecorder::writeOutput(const char *data, const qint64 size)
+{
+    // Every segment is a complete stream with its own header
+    if (m_segmentSize + size > maxSegmentSize && m_segmentSize > streamHeader().size()) {
+        closeOutput();
+
+        if (!openSegment() || !writeOutput(streamHeader().constData(), streamHeader().size()))
+            return false;
+    }
+
+    if (m_file.write(data, size) != size) {
+        qCritical() << "Recording stopped" << m_file.fileName() << m_file.errorString();
+        return false;
+    }
+
+    m_segmentSize += size;
+    return true;
+}
+
+void SessionRecorder::closeOutput()
+{
+    m_file.close();
+}
+
+bool SessionRecorder::openSegment()
+{
+    ++m_segment;
+    m_segmentSize = 0;
+    m_file.setFileName(QDir{ m_directory }.filePath(QString("%1-%2.y4m").arg(m_baseName).arg(m_segment, 3, 10, QChar('0'))));
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        qCritical() << "Failed to open recording" << m_file.fileName() << m_file.errorString();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "writebehindsink.h"
+
+#include <QFile>
+
+// Records the output into Y4M segments, a new file every couple of
+// gigabytes so a long session never hits file size limits. Frames are
+// written unbuffered, one large write per frame, from the writer thread.
+class SessionRecorder : public WriteBehindSink
+{
+    Q_OBJECT
+
+public:
+    SessionRecorder(PipelineMetrics *metrics, const QString &directory, QObject *parent = nullptr);
+    ~SessionRecorder();
+
+    const QString &directory() const { return m_directory; }
+
+protected:
+    bool openOutput() override;
+    bool writeOutput(const char *data, const qint64 size) override;
+    void closeOutput() override;
+
+private:
+    bool openSegment();
+
+private:
+    QString m_directory;
+    QString m_baseName;
+    QFile m_file;
+    int m_segment;
+    qint64 m_segmentSize;
+
+};
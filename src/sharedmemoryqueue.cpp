@@ -1,8 +1,14 @@
 #include "sharedmemoryqueue.h"
 
+#include <libyuv.h>
+
+#include <cstring>
+
+#ifdef Q_OS_WIN
 #include <windows.h>
 
 #define VIDEO_NAME L"OBSVirtualCamVideo"
+#endif
 
 enum QueueType
 {
@@ -31,22 +37,65 @@ struct QueueHeader
     std::uint32_t cy;
     std::uint64_t interval;
 
+    // reserved[0] is the fourcc of the frames, reserved[1] their size in
+    // bytes, reserved[2] the matrix (601 or 709) and reserved[3] is 1 for
+    // full range. Zero means NV12 BT.601 limited range for readers that
+    // predate the negotiation.
     std::uint32_t reserved[8];
 };
 
 struct VideoQueue
 {
-    HANDLE handle;
+    void *handle;
     bool ready_to_read;
     QueueHeader *header;
     std::uint64_t *ts[3];
     std::uint8_t *frame[3];
     bool is_writer;
+    PixelLayout layout;
 };
 
 #define ALIGN_SIZE(size, align) size = (((size) + (align - 1)) & (~(align - 1)))
 #define FRAME_HEADER_SIZE 32
 
+namespace
+{
+#ifdef Q_OS_WIN
+    QueueHeader *map_queue(VideoQueue *vq, const std::uint32_t size)
+    {
+        vq->handle = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL,
+            PAGE_READWRITE, 0, size, VIDEO_NAME);
+
+        if (!vq->handle) {
+            return nullptr;
+        }
+
+        QueueHeader *header = (QueueHeader *)MapViewOfFile(vq->handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+        if (!header) {
+            CloseHandle(vq->handle);
+        }
+
+        return header;
+    }
+
+    void unmap_queue(VideoQueue *vq)
+    {
+        UnmapViewOfFile(vq->header);
+        CloseHandle(vq->handle);
+    }
+#else
+    // The OBS virtual camera only exists on Windows, frames still go to the sinks
+    QueueHeader *map_queue(VideoQueue *, const std::uint32_t)
+    {
+        return nullptr;
+    }
+
+    void unmap_queue(VideoQueue *)
+    {}
+#endif
+}
+
 SharedMemoryQueue::SharedMemoryQueue(QObject *parent) :
     QObject(parent),
     vq{ new VideoQueue() }
@@ -57,11 +106,11 @@ SharedMemoryQueue::~SharedMemoryQueue()
     delete vq;
 }
 
-bool SharedMemoryQueue::create(const std::uint32_t cx, const std::uint32_t cy, const std::uint64_t interval)
+bool SharedMemoryQueue::create(const std::uint32_t cx, const std::uint32_t cy, const std::uint64_t interval, const PixelLayout layout, const ColorMatrix matrix, const ColorRange range)
 {
-    DWORD frame_size = cx * cy * 3 / 2;
+    std::uint32_t frame_size = std::uint32_t(packed_size(layout, cx, cy));
     uint32_t offset_frame[3]{ 0 };
-    DWORD size = sizeof(QueueHeader);
+    std::uint32_t size = sizeof(QueueHeader);
 
     ALIGN_SIZE(size, 32);
 
@@ -83,7 +132,13 @@ bool SharedMemoryQueue::create(const std::uint32_t cx, const std::uint32_t cy, c
     header.cx = cx;
     header.cy = cy;
     header.interval = interval;
+    header.type = SHARED_QUEUE_TYPE_VIDEO;
+    header.reserved[0] = layout_fourcc(layout);
+    header.reserved[1] = frame_size;
+    header.reserved[2] = matrix == ColorMatrix::BT709 ? 709 : 601;
+    header.reserved[3] = range == ColorRange::Full ? 1 : 0;
     vq->is_writer = true;
+    vq->layout = layout;
 
     for (size_t i = 0; i < 3; i++) {
         uint32_t off = offset_frame[i];
@@ -98,17 +153,9 @@ bool SharedMemoryQueue::create(const std::uint32_t cx, const std::uint32_t cy, c
         return false;
     }*/
 
-    vq->handle = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL,
-        PAGE_READWRITE, 0, size, VIDEO_NAME);
-    
-    if (!vq->handle) {
-        return false;
-    }
-
-    vq->header = (QueueHeader *)MapViewOfFile(vq->handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    vq->header = map_queue(vq, size);
 
     if (!vq->header) {
-        CloseHandle(vq->handle);
         return false;
     }
 
@@ -125,7 +172,7 @@ bool SharedMemoryQueue::create(const std::uint32_t cx, const std::uint32_t cy, c
 
 void SharedMemoryQueue::close()
 {
-    if (!vq) {
+    if (!vq || !vq->header) {
         return;
     }
 
@@ -133,23 +180,29 @@ void SharedMemoryQueue::close()
         vq->header->state = SHARED_QUEUE_STATE_STOPPING;
     }
 
-    UnmapViewOfFile(vq->header);
-    CloseHandle(vq->handle);
+    unmap_queue(vq);
+    vq->header = nullptr;
 }
 
 #define get_idx(inc) ((unsigned long)inc % 3)
 
-void SharedMemoryQueue::write(const std::uint8_t **data, const std::uint32_t *linesize, const std::uint64_t timestamp)
+void SharedMemoryQueue::write(const FrameView &frame, const std::uint64_t timestamp)
 {
     QueueHeader *qh = vq->header;
     long inc = ++qh->write_idx;
 
     unsigned long idx = get_idx(inc);
-    size_t size = linesize[0] * qh->cy;
+    // Queue holds packed planes, source planes may be padded
+    std::uint8_t *plane = vq->frame[idx];
 
     *vq->ts[idx] = timestamp;
-    memcpy(vq->frame[idx], data[0], size);
-    memcpy(vq->frame[idx] + size, data[1], size / 2);
+
+    for (int i = 0; i < plane_count(vq->layout); ++i) {
+        const std::int32_t row_bytes = plane_row_bytes(vq->layout, i, qh->cx);
+        const std::int32_t rows = plane_rows(vq->layout, i, qh->cy);
+        libyuv::CopyPlane(frame.data[i], frame.stride[i], plane, row_bytes, row_bytes, rows);
+        plane += row_bytes * rows;
+    }
 
     qh->read_idx = inc;
     qh->state = SHARED_QUEUE_STATE_READY;
@@ -2,6 +2,9 @@
 
 #include <QObject>
 
+#include "colorconversion.h"
+#include "framebuffer.h"
+
 struct VideoQueue;
 
 class SharedMemoryQueue  : public QObject
@@ -15,14 +18,13 @@ public:
     bool create(
         const std::uint32_t cx,
         const std::uint32_t cy,
-        const std::uint64_t interval
+        const std::uint64_t interval,
+        const PixelLayout layout = PixelLayout::NV12,
+        const ColorMatrix matrix = ColorMatrix::BT601,
+        const ColorRange range = ColorRange::Limited
     );
     void close();
-    void write(
-        const std::uint8_t **data,
-        const std::uint32_t *linesize,
-        const std::uint64_t timestamp
-    );
+    void write(const FrameView &frame, const std::uint64_t timestamp);
 
 private:
     VideoQueue *vq;
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "framebuffer.h"
+
+#include <cstdint>
+
+// Effect applied in place to the BGRA camera frame before the overlay.
+// Filters are run by the FilterChain, which hands per pixel filters the
+// frame in bands of rows, so adjacent ones share a pass over the frame.
+class VideoFilter
+{
+public:
+    enum class Access
+    {
+        // Output pixel depends only on the same input pixel, bands of
+        // rows are processed concurrently
+        PerPixel,
+        // Needs the whole frame at once
+        Neighborhood
+    };
+
+    virtual ~VideoFilter() = default;
+
+    virtual Access access() const = 0;
+    virtual bool isEnabled() const = 0;
+    // Called once per frame before any rows are processed
+    virtual void prepare(const FrameView &) {}
+    // Rows first to first + count, always the whole frame for neighborhood filters
+    virtual void process(const FrameView &frame, const std::int32_t first, const std::int32_t count) = 0;
+};
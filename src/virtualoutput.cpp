@@ -1,85 +1,99 @@
 #include "virtualoutput.h"
+#include "framesink.h"
 
 #include <QDebug>
+#include <QTimer>
 #include <libyuv.h>
+
+#include <cstdlib>
+
+#ifdef Q_OS_WIN
 #include <windows.h>
+#else
+#include <chrono>
+#endif
 
 namespace
 {
-    const std::int32_t i420_frame_size(const std::int32_t width, const std::int32_t height)
-    {
-        return width * height * 3 / 2;
-    }
-
-    void rgb_to_i420(const uint8_t *rgb, uint8_t *i420, int32_t width, int32_t height)
-    {
-        int32_t height_ = height;
-        height = std::abs(height);
-        int32_t half_width = width / 2;
-        int32_t half_height = height / 2;
-
-        libyuv::ARGBToI420(
-            rgb, width * 4,
-            i420, width,
-            i420 + width * height, half_width,
-            i420 + width * height + half_width * half_height, half_width,
-            width, height_);
-    }
-
-    void i420_to_nv12(const uint8_t *i420, uint8_t *nv12, int32_t width, int32_t height)
-    {
-        int32_t height_ = height;
-        height = std::abs(height);
-        int32_t half_width = width / 2;
-        int32_t half_height = height / 2;
-
-        libyuv::I420ToNV12(
-            i420, width,
-            i420 + width * height, half_width,
-            i420 + width * height + half_width * half_height, half_width,
-            nv12, width,
-            nv12 + width * height, width,
-            width, height_);
-    }
+    const int keepAliveInterval = 500;
 }
 
-#define nv12_frame_size i420_frame_size
-
 VirtualOutput::VirtualOutput(QObject *parent) :
-    QObject(parent)
-{}
+    QObject(parent),
+    _keep_alive{ new QTimer(this) }
+{
+    connect(_keep_alive, &QTimer::timeout, this, &VirtualOutput::keep_alive);
+}
 
 VirtualOutput::~VirtualOutput()
 {}
 
-bool VirtualOutput::start(const std::uint32_t width, const std::uint32_t height, const double fps)
+bool VirtualOutput::start(const std::uint32_t width, const std::uint32_t height, const double fps, const PixelLayout format, const ColorRange range)
 {
+#ifdef Q_OS_WIN
     // https://github.com/obsproject/obs-studio/blob/9da6fc67/.github/workflows/main.yml#L484
     LPCWSTR guid = L"CLSID\\{A3FCE0F5-3493-419F-958A-ABA1250EC20B}";
     HKEY key = nullptr;
+    const bool haveDevice = RegOpenKeyExW(HKEY_CLASSES_ROOT, guid, 0, KEY_READ, &key) == ERROR_SUCCESS;
+
+    if (key)
+        RegCloseKey(key);
 
-    if (RegOpenKeyExW(HKEY_CLASSES_ROOT, guid, 0, KEY_READ, &key) != ERROR_SUCCESS) {
-        qCritical() << "OBS Virtual Camera device not found!";
+    if (!haveDevice) {
+        qWarning() << "OBS Virtual Camera device not found!";
         qInfo() << "Did you install OBS?";
+    }
+#else
+    // OBS Virtual Camera queue is Windows only
+    const bool haveDevice = false;
+#endif
+
+    // Without the device frames can still go to the other sinks
+    if (!haveDevice && m_sinks.isEmpty())
+        return false;
+
+    // HD consumers assume BT.709, SD ones BT.601
+    const ColorMatrix matrix = height >= 720 ? ColorMatrix::BT709 : ColorMatrix::BT601;
+    _convert = find_yuv_converter(format, matrix, range);
+
+    if (!_convert) {
+        qCritical() << "Unsupported virtual camera output format";
         return false;
     }
 
-    //_frame_fourcc = libyuv::CanonicalFourCC(fourcc);
+    _frame_format = format;
     _frame_width = width;
     _frame_height = height;
+    _frame_rate = fps;
+    _frame_matrix = matrix;
+    _frame_range = range;
 
-    uint32_t out_frame_size = nv12_frame_size(width, height);
-    // RGB|BGR -> I420 -> NV12
-    _buffer_tmp.resize(i420_frame_size(width, height));
-    _buffer_output.resize(out_frame_size);
+    // BGRA -> NV12|I420|YUY2 in one pass
+    _buffer_output.allocate(format, width, height);
 
     uint64_t interval = (uint64_t)(10000000.0 / fps);
 
-    if (!m_queue.create(width, height, interval)) {
+    _queue_open = haveDevice && m_queue.create(width, height, interval, format, matrix, range);
+
+    if (haveDevice && !_queue_open)
         qCritical() << "Virtual camera output could not be started";
+
+    bool started = _queue_open;
+
+    for (FrameSink *sink : m_sinks)
+        started = sink->start(format, width, height, fps, matrix, range) || started;
+
+    if (!started) {
+        if (_queue_open)
+            m_queue.close();
+
+        _queue_open = false;
         return false;
     }
 
+    _have_placeholder = false;
+    _last_frame.start();
+    _keep_alive->start(keepAliveInterval);
     _output_running = true;
     return true;
 }
@@ -90,38 +104,109 @@ void VirtualOutput::stop()
         return;
     }
 
-    m_queue.close();
+    if (_queue_open)
+        m_queue.close();
+
+    for (FrameSink *sink : m_sinks)
+        sink->stop();
+
+    _keep_alive->stop();
+    _buffer_scaled.release();
+    _buffer_placeholder.release();
+    _have_placeholder = false;
+    _queue_open = false;
     _output_running = false;
 }
 
-void VirtualOutput::send(const std::uint8_t *frame)
+void VirtualOutput::send(const FrameView &frame)
 {
     if (!_output_running)
         return;
 
-    uint8_t *tmp = _buffer_tmp.data();
-    uint8_t *out_frame;
+    const FrameView &out_frame = _buffer_output.view();
+    _convert(fit_frame(frame), out_frame);
 
-    // Always RGB
-    out_frame = _buffer_output.data();
-    rgb_to_i420(frame, tmp, _frame_width, _frame_height);
-    i420_to_nv12(tmp, out_frame, _frame_width, _frame_height);
+    uint64_t timestamp = get_timestamp_ns();
+    _last_frame.start();
 
-    // NV12 has two planes
-    uint8_t *y = out_frame;
-    uint8_t *uv = out_frame + _frame_width * _frame_height;
+    if (_queue_open && _live)
+        m_queue.write(out_frame, timestamp);
 
-    // One entry per plane
-    uint32_t linesize[2] = { _frame_width, _frame_width / 2 };
-    const uint8_t *data[2] = { y, uv };
+    for (FrameSink *sink : m_sinks)
+        sink->write(out_frame, timestamp);
+}
 
-    uint64_t timestamp = get_timestamp_ns();
+void VirtualOutput::setLive(const bool live)
+{
+    _live = live;
+}
 
-    m_queue.write(data, linesize, timestamp);
+void VirtualOutput::publish(const FrameView &frame)
+{
+    if (_output_running && _queue_open)
+        m_queue.write(frame, get_timestamp_ns());
+}
+
+void VirtualOutput::setPlaceholder(const FrameView &frame)
+{
+    if (!_output_running)
+        return;
+
+    _buffer_placeholder.allocate(_frame_format, _frame_width, _frame_height);
+    _convert(fit_frame(frame), _buffer_placeholder.view());
+    _have_placeholder = true;
+}
+
+void VirtualOutput::keep_alive()
+{
+    if (!_queue_open || !_live || !_have_placeholder || _last_frame.elapsed() < keepAliveInterval)
+        return;
+
+    m_queue.write(_buffer_placeholder.view(), get_timestamp_ns());
+}
+
+void VirtualOutput::addSink(FrameSink *sink)
+{
+    if (m_sinks.contains(sink))
+        return;
+
+    m_sinks.append(sink);
+
+    if (_output_running)
+        sink->start(_frame_format, _frame_width, _frame_height, _frame_rate, _frame_matrix, _frame_range);
+}
+
+void VirtualOutput::removeSink(FrameSink *sink)
+{
+    if (m_sinks.removeOne(sink) && _output_running)
+        sink->stop();
+}
+
+const FrameView &VirtualOutput::fit_frame(const FrameView &frame)
+{
+    const std::int32_t width = std::int32_t(_frame_width);
+    const std::int32_t height = std::int32_t(_frame_height);
+
+    // The camera may deliver another size than the format the output was started with
+    if (frame.width == width && std::abs(frame.height) == height)
+        return frame;
+
+    _buffer_scaled.allocate(PixelLayout::BGRA, width, height);
+    const FrameView &scaled = _buffer_scaled.view();
+
+    // Negative height of a bottom-up frame flips it upright here
+    libyuv::ARGBScale(
+        frame.data[0], frame.stride[0], frame.width, frame.height,
+        scaled.data[0], scaled.stride[0], width, height,
+        libyuv::kFilterBilinear);
+
+    return scaled;
 }
 
 std::uint64_t VirtualOutput::get_timestamp_ns()
 {
+#ifdef Q_OS_WIN
+    // Same clock as OBS timestamps its own frames with
     if (!_have_clockfreq) {
         LARGE_INTEGER frequency;
         QueryPerformanceFrequency(&frequency);
@@ -136,4 +221,9 @@ std::uint64_t VirtualOutput::get_timestamp_ns()
     time_val /= (double)_clock_freq;
 
     return static_cast<uint64_t>(time_val);
-}
\ No newline at end of file
+#else
+    // CLOCK_MONOTONIC on Linux, what subscribers of the local sink compare with
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+#endif
+}
@@ -1,8 +1,15 @@
 #pragma once
 
+#include "colorconversion.h"
+#include "framebuffer.h"
 #include "sharedmemoryqueue.h"
 
 #include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+
+class QTimer;
+class FrameSink;
 
 class VirtualOutput  : public QObject
 {
@@ -13,25 +20,56 @@ public:
     ~VirtualOutput();
 
     bool isStarted() const { return _output_running; }
+    std::uint32_t width() const { return _frame_width; }
+    std::uint32_t height() const { return _frame_height; }
     bool start(
         const std::uint32_t width,
         const std::uint32_t height,
-        const double fps
+        const double fps,
+        const PixelLayout format = PixelLayout::NV12,
+        const ColorRange range = ColorRange::Limited
     );
     void stop();
-    void send(const std::uint8_t *frame);
+    void send(const FrameView &frame);
+
+    // While not live the queue only gets published frames, sinks still
+    // get every live frame, see ReplayBuffer
+    void setLive(const bool live);
+    void publish(const FrameView &frame);
+    // Converted once and republished to the queue at a low rate whenever
+    // live frames stop coming, e.g. the camera is stopped or switching
+    void setPlaceholder(const FrameView &frame);
+
+    // Sinks get every converted frame after the virtual camera queue
+    void addSink(FrameSink *sink);
+    void removeSink(FrameSink *sink);
 
 private:
     std::uint64_t get_timestamp_ns();
+    void keep_alive();
+    const FrameView &fit_frame(const FrameView &frame);
 
 private:
     SharedMemoryQueue m_queue;
+    QList<FrameSink *> m_sinks;
     bool _output_running = false;
-    std::uint32_t _frame_width;
-    std::uint32_t _frame_height;
-    //std::uint32_t _frame_fourcc; Always RGB
-    std::vector<uint8_t> _buffer_tmp;
-    std::vector<uint8_t> _buffer_output;
+    bool _queue_open = false;
+    bool _live = true;
+    std::uint32_t _frame_width = 0;
+    std::uint32_t _frame_height = 0;
+    double _frame_rate;
+    ColorMatrix _frame_matrix;
+    ColorRange _frame_range;
+    // Input is always the composited BGRA frame
+    PixelLayout _frame_format;
+    frame_converter _convert = nullptr;
+    AlignedFrameBuffer _buffer_output;
+    // Input frames of another size than the output, scaled to it
+    AlignedFrameBuffer _buffer_scaled;
+    AlignedFrameBuffer _buffer_placeholder;
+    bool _have_placeholder = false;
+    QElapsedTimer _last_frame;
+    QTimer *_keep_alive;
     bool _have_clockfreq = false;
     long long _clock_freq;
 
@@ -0,0 +1,226 @@
+#include "writebehindsink.h"
+#include "pipelinemetrics.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QThread>
+#include <libyuv.h>
+
+#include <cstring>
+
+namespace
+{
+    const std::size_t defaultMemoryLimit = 64 * 1024 * 1024;
+    const QByteArray frameMarker = "FRAME\n";
+
+    // Planar layout the Y4M stream is written in
+    PixelLayout y4m_layout(const PixelLayout layout)
+    {
+        return layout == PixelLayout::YUYV ? PixelLayout::I422 : PixelLayout::I420;
+    }
+}
+
+WriteBehindSink::WriteBehindSink(PipelineMetrics *metrics, const QString &name, QObject *parent) :
+    QObject(parent),
+    m_metrics{ metrics },
+    m_name{ name },
+    m_format{ Format::Y4M },
+    m_memoryLimit{ defaultMemoryLimit },
+    m_thread{ nullptr },
+    m_stopping{ false },
+    m_failed{ false },
+    m_layout{ PixelLayout::NV12 },
+    m_width{ 0 },
+    m_height{ 0 }
+{}
+
+WriteBehindSink::~WriteBehindSink()
+{}
+
+void WriteBehindSink::setFormat(const Format format)
+{
+    m_format = format;
+}
+
+void WriteBehindSink::setMemoryLimit(const std::size_t bytes)
+{
+    m_memoryLimit = bytes;
+}
+
+bool WriteBehindSink::start(const PixelLayout layout, const std::int32_t width, const std::int32_t height, const double fps, const ColorMatrix matrix, const ColorRange range)
+{
+    // Y4M has no field for it
+    Q_UNUSED(matrix);
+    stop();
+
+    if (layout != PixelLayout::NV12 && layout != PixelLayout::I420 && layout != PixelLayout::YUYV) {
+        qWarning() << "Unsupported" << m_name << "output format";
+        return false;
+    }
+
+    m_layout = layout;
+    m_width = width;
+    m_height = height;
+    m_header.clear();
+    qsizetype frameSize = qsizetype(packed_size(layout, width, height));
+
+    if (m_format == Format::Y4M) {
+        // Frame rate as a fraction keeps 29.97 and friends exact enough
+        m_header = QString("YUV4MPEG2 W%1 H%2 F%3:1000 Ip A1:1 %4 XCOLORRANGE=%5\n")
+            .arg(width)
+            .arg(height)
+            .arg(qRound(fps * 1000))
+            .arg(y4m_layout(layout) == PixelLayout::I422 ? "C422" : "C420jpeg")
+            .arg(range == ColorRange::Full ? "FULL" : "LIMITED")
+            .toLatin1();
+        frameSize = frameMarker.size() + qsizetype(packed_size(y4m_layout(layout), width, height));
+    }
+
+    const qsizetype count = qMax<qsizetype>(1, qsizetype(m_memoryLimit) / frameSize);
+
+    for (qsizetype i = 0; i < count; ++i)
+        m_free.append(QByteArray(frameSize, Qt::Uninitialized));
+
+    m_stopping = false;
+    m_failed = false;
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->start();
+    return true;
+}
+
+void WriteBehindSink::stop()
+{
+    if (!m_thread)
+        return;
+
+    {
+        QMutexLocker locker{ &m_mutex };
+        m_stopping = true;
+    }
+
+    // Whatever is queued still gets written
+    m_queued.wakeAll();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+
+    m_free.clear();
+    m_pending.clear();
+}
+
+void WriteBehindSink::write(const FrameView &frame, const std::uint64_t timestamp)
+{
+    Q_UNUSED(timestamp);
+
+    if (!m_thread || m_failed)
+        return;
+
+    QByteArray buffer;
+
+    {
+        QMutexLocker locker{ &m_mutex };
+
+        if (m_free.isEmpty()) {
+            locker.unlock();
+            m_metrics->count(m_name + " dropped");
+            return;
+        }
+
+        buffer = m_free.takeLast();
+    }
+
+    // Buffer is not shared, data() does not detach
+    pack(frame, reinterpret_cast<std::uint8_t *>(buffer.data()));
+
+    {
+        QMutexLocker locker{ &m_mutex };
+        m_pending.append(std::move(buffer));
+    }
+
+    m_queued.wakeOne();
+}
+
+void WriteBehindSink::run()
+{
+    if (!openOutput()) {
+        m_failed = true;
+        return;
+    }
+
+    bool written = m_header.isEmpty() || writeOutput(m_header.constData(), m_header.size());
+
+    while (written) {
+        QByteArray buffer;
+
+        {
+            QMutexLocker locker{ &m_mutex };
+
+            while (m_pending.isEmpty() && !m_stopping)
+                m_queued.wait(&m_mutex);
+
+            if (m_pending.isEmpty())
+                break;
+
+            buffer = m_pending.takeFirst();
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        written = writeOutput(buffer.constData(), buffer.size());
+        m_metrics->record(m_name + " write", timer.nsecsElapsed());
+
+        if (written)
+            m_metrics->transfer(m_name, buffer.size());
+
+        QMutexLocker locker{ &m_mutex };
+        m_free.append(std::move(buffer));
+    }
+
+    // Nothing more is queued once the output is broken
+    if (!written)
+        m_failed = true;
+
+    closeOutput();
+}
+
+void WriteBehindSink::pack(const FrameView &frame, std::uint8_t *data) const
+{
+    if (m_format == Format::Raw) {
+        const FrameView packed = packed_view(m_layout, data, m_width, m_height);
+
+        for (int i = 0; i < plane_count(m_layout); ++i) {
+            const std::int32_t row_bytes = plane_row_bytes(m_layout, i, m_width);
+            libyuv::CopyPlane(frame.data[i], frame.stride[i], packed.data[i], packed.stride[i], row_bytes, plane_rows(m_layout, i, m_height));
+        }
+
+        return;
+    }
+
+    std::memcpy(data, frameMarker.constData(), frameMarker.size());
+    const FrameView planar = packed_view(y4m_layout(m_layout), data + frameMarker.size(), m_width, m_height);
+    const std::int32_t half_width = (m_width + 1) / 2;
+    const std::int32_t half_height = (m_height + 1) / 2;
+
+    switch (m_layout) {
+    case PixelLayout::NV12:
+        libyuv::CopyPlane(frame.data[0], frame.stride[0], planar.data[0], planar.stride[0], m_width, m_height);
+        libyuv::SplitUVPlane(frame.data[1], frame.stride[1], planar.data[1], planar.stride[1], planar.data[2], planar.stride[2], half_width, half_height);
+        break;
+    case PixelLayout::I420:
+        libyuv::I420Copy(
+            frame.data[0], frame.stride[0], frame.data[1], frame.stride[1], frame.data[2], frame.stride[2],
+            planar.data[0], planar.stride[0], planar.data[1], planar.stride[1], planar.data[2], planar.stride[2],
+            m_width, m_height
+        );
+        break;
+    case PixelLayout::YUYV:
+        libyuv::YUY2ToI422(
+            frame.data[0], frame.stride[0],
+            planar.data[0], planar.stride[0], planar.data[1], planar.stride[1], planar.data[2], planar.stride[2],
+            m_width, m_height
+        );
+        break;
+    default:
+        break;
+    }
+}
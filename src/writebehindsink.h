@@ -0,0 +1,80 @@
+#pragma once
+
+#include "framesink.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+#include <atomic>
+
+class QThread;
+class PipelineMetrics;
+
+// Frame sink that packs frames into buffers and writes them from a thread
+// of its own, so a slow reader or disk never holds up the frame path.
+// Buffers are allocated once in start() within the memory limit; a frame
+// arriving while all of them are queued is dropped and counted.
+// Subclasses have to call stop() in their destructor.
+class WriteBehindSink : public QObject, public FrameSink
+{
+    Q_OBJECT
+
+public:
+    // Y4M is always planar: NV12 and I420 become 4:2:0, YUY2 becomes 4:2:2
+    enum class Format
+    {
+        Y4M,
+        Raw
+    };
+
+    WriteBehindSink(PipelineMetrics *metrics, const QString &name, QObject *parent = nullptr);
+    ~WriteBehindSink();
+
+    Format format() const { return m_format; }
+    void setFormat(const Format format);
+    std::size_t memoryLimit() const { return m_memoryLimit; }
+    // Takes effect on the next start
+    void setMemoryLimit(const std::size_t bytes);
+
+    bool start(const PixelLayout layout, const std::int32_t width, const std::int32_t height, const double fps, const ColorMatrix matrix, const ColorRange range) override;
+    void stop() override;
+    void write(const FrameView &frame, const std::uint64_t timestamp) override;
+
+protected:
+    // Called on the writer thread, the stream header is written right after opening
+    virtual bool openOutput() = 0;
+    virtual bool writeOutput(const char *data, const qint64 size) = 0;
+    virtual void closeOutput() = 0;
+
+    const QString &name() const { return m_name; }
+    PipelineMetrics *metrics() const { return m_metrics; }
+    // Y4M stream header, empty for raw frames
+    const QByteArray &streamHeader() const { return m_header; }
+    bool isStopping() const { return m_stopping; }
+
+private:
+    void run();
+    void pack(const FrameView &frame, std::uint8_t *data) const;
+
+private:
+    PipelineMetrics *m_metrics;
+    QString m_name;
+    Format m_format;
+    std::size_t m_memoryLimit;
+    QThread *m_thread;
+    QMutex m_mutex;
+    QWaitCondition m_queued;
+    QList<QByteArray> m_free;
+    QList<QByteArray> m_pending;
+    std::atomic<bool> m_stopping;
+    std::atomic<bool> m_failed;
+    PixelLayout m_layout;
+    std::int32_t m_width;
+    std::int32_t m_height;
+    QByteArray m_header;
+
+};